@@ -0,0 +1,60 @@
+// Runs the same spawn/iterate/despawn workload against both Scene backends.
+#include "health.cpp"
+#include "position.cpp"
+#include "scene.cpp"
+#include "velocity.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+template <typename SceneType> void runWorkload(const char *name, int count) {
+  using Clock = std::chrono::steady_clock;
+  SceneType scene;
+  auto &registry = scene.registry;
+
+  auto start = Clock::now();
+  std::vector<Entity> entities = registry.create(count);
+  for (int i = 0; i < count; i++) {
+    registry.addComponent(entities[i], Position(float(i), 0, 0));
+    registry.addComponent(entities[i], Velocity(1, 1, 1));
+    if (i % 2 == 0) {
+      registry.addComponent(entities[i], Health(100));
+    }
+  }
+  auto spawned = Clock::now();
+
+  const int frames = 20;
+  for (int frame = 0; frame < frames; frame++) {
+    registry.template view<Position, Velocity>().each(
+        [](auto &&position, auto &&velocity) {
+          position.x += velocity.x;
+          position.y += velocity.y;
+          position.z += velocity.z;
+        });
+  }
+  auto iterated = Clock::now();
+
+  for (int i = 0; i < count; i += 2) {
+    registry.template removeComponent<Health>(entities[i]);
+  }
+  for (int i = 0; i < count; i++) {
+    registry.destroy(entities[i]);
+  }
+  auto despawned = Clock::now();
+
+  auto ms = [](Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+  };
+  std::printf("%-10s %8d  spawn %8.2f ms  iterate %8.3f ms/frame  "
+              "despawn %8.2f ms\n",
+              name, count, ms(start, spawned), ms(spawned, iterated) / frames,
+              ms(iterated, despawned));
+}
+
+int main() {
+  for (int count : {10000, 100000, 1000000}) {
+    runWorkload<Scene>("sparse", count);
+    runWorkload<ArchetypeScene>("archetype", count);
+  }
+}
@@ -0,0 +1,44 @@
+// Render extraction: gather + write of Position/Renderable entities into an
+// instance array, as drawFrame does into mapped memory, and how many draw
+// calls the resulting batches need.
+#include "renderextract.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+int main() {
+  for (int count : {1000, 10000, 100000, 1000000}) {
+    Registry registry;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> coordinate(-150.0f, 150.0f);
+    for (int i = 0; i < count; i++) {
+      Entity entity = registry.create();
+      registry.addComponent(entity,
+                            Position(coordinate(rng), coordinate(rng), 0));
+      registry.addComponent(entity, Renderable(i % 2, 1.0f));
+    }
+
+    RenderExtractor extractor;
+    RenderView view{-100, -100, 100, 100};
+    std::vector<InstanceData> instances(count);
+
+    const int repetitions = 20;
+    uint32_t visible = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < repetitions; rep++) {
+      visible = extractor.gather(registry, view);
+      extractor.write(registry, instances.data(), visible);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ms =
+        std::chrono::duration<double, std::milli>(end - start).count() /
+        repetitions;
+
+    std::printf("%8d entities: %8u visible, %.3f ms, %.2f ns/entity, "
+                "%zu draw calls\n",
+                count, visible, ms, ms * 1e6 / count,
+                extractor.batches().size());
+  }
+}
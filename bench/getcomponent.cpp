@@ -0,0 +1,81 @@
+// Measures Registry::getComponent against the type_index/shared_ptr storage
+// lookup the registry used before component type IDs.
+#include "position.cpp"
+#include "registry.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+struct TypeIndexRegistry {
+  std::unordered_map<std::type_index, std::shared_ptr<void>> componentStorages;
+
+  template <typename T> void addComponent(Entity entityID, const T &component) {
+    getStorage<T>().addComponent(entityID, component);
+  }
+
+  template <typename T>
+  typename ComponentStorage<T>::Pointer getComponent(Entity entityID) {
+    return getStorage<T>().getComponent(entityID);
+  }
+
+  template <typename T> ComponentStorage<T> &getStorage() {
+    std::type_index type_index = std::type_index(typeid(T));
+
+    if (componentStorages.find(type_index) == componentStorages.end()) {
+      componentStorages[type_index] = std::make_shared<ComponentStorage<T>>();
+    }
+
+    return *std::static_pointer_cast<ComponentStorage<T>>(
+        componentStorages[type_index]);
+  }
+};
+
+template <typename RegistryType>
+double nsPerGet(RegistryType &registry, const std::vector<Entity> &order) {
+  float sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (Entity entity : order) {
+    sum += registry.template getComponent<Position>(entity)->x;
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  // Keep the loop from being optimised away.
+  if (sum == -1.0f) {
+    std::printf("%f\n", sum);
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         order.size();
+}
+
+int main() {
+  const int entityCount = 1000000;
+  const int rounds = 5;
+
+  Registry registry;
+  TypeIndexRegistry typeIndexRegistry;
+  std::vector<Entity> entities = registry.create(entityCount);
+  for (Entity entity : entities) {
+    registry.addComponent(entity, Position(1, 2, 3));
+    typeIndexRegistry.addComponent(entity, Position(1, 2, 3));
+  }
+
+  std::vector<Entity> sequential = entities;
+  std::vector<Entity> shuffled = entities;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+  for (int round = 0; round < rounds; round++) {
+    std::printf("round %d\n", round);
+    std::printf("  sequential  type_index map %6.2f ns   type id %6.2f ns\n",
+                nsPerGet(typeIndexRegistry, sequential),
+                nsPerGet(registry, sequential));
+    std::printf("  random      type_index map %6.2f ns   type id %6.2f ns\n",
+                nsPerGet(typeIndexRegistry, shuffled),
+                nsPerGet(registry, shuffled));
+  }
+}
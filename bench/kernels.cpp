@@ -0,0 +1,62 @@
+// Scalar, SSE and AVX2 stream kernels over 1M SoA positions.
+#include "simd.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+template <typename Func> double msPerCall(Func func) {
+  const int calls = 20;
+  auto start = std::chrono::steady_clock::now();
+  for (int call = 0; call < calls; call++) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         calls;
+}
+
+int main() {
+  const int count = 1000000;
+  std::vector<float> x(count), y(count), z(count);
+  std::vector<float> vx(count, 1), vy(count, 2), vz(count, 3);
+  std::vector<float> distances(count);
+  std::vector<uint8_t> inside(count);
+  for (int i = 0; i < count; i++) {
+    x[i] = float(i % 1000);
+    y[i] = float(i % 777);
+    z[i] = float(i % 555);
+  }
+
+  std::vector<StreamKernels> variants = {
+      {integrateScalar, inBoundsScalar, distanceSquaredScalar, "scalar"}};
+#if GW_SIMD_SSE
+  variants.push_back({integrateSSE, inBoundsSSE, distanceSquaredSSE, "sse"});
+#endif
+#if GW_SIMD_X86
+  if (cpuSupportsAVX2()) {
+    variants.push_back(
+        {integrateAVX2, inBoundsAVX2, distanceSquaredAVX2, "avx2"});
+  }
+#endif
+
+  std::printf("dispatch picks %s\n", streamKernels().name);
+  for (const StreamKernels &kernels : variants) {
+    double integrate = msPerCall([&] {
+      kernels.integrate(x.data(), y.data(), z.data(), vx.data(), vy.data(),
+                        vz.data(), 0.016f, count);
+    });
+    double bounds = msPerCall([&] {
+      kernels.inBounds(x.data(), y.data(), z.data(), Vector3(100, 100, 100),
+                       Vector3(500, 500, 500), inside.data(), count);
+    });
+    double distance = msPerCall([&] {
+      kernels.distanceSquared(x.data(), y.data(), z.data(),
+                              Vector3(1, 2, 3), distances.data(), count);
+    });
+    std::printf("%-7s integrate %7.3f ms  inBounds %7.3f ms  distance %7.3f "
+                "ms\n",
+                kernels.name, integrate, bounds, distance);
+  }
+}
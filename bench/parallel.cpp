@@ -0,0 +1,69 @@
+// Scaling of View::parallelEach and Group::parallelEach from one thread to
+// every core, over Position/Velocity integration.
+#include "position.cpp"
+#include "registry.cpp"
+#include "velocity.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+template <typename Iterable>
+double msPerPass(Iterable &&iterable, ThreadPool &pool) {
+  const int passes = 5;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    iterable.parallelEach(
+        [](auto &&position, auto &&velocity) {
+          position.x += velocity.x * 0.016f;
+          position.y += velocity.y * 0.016f;
+          position.z += velocity.z * 0.016f;
+        },
+        pool);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         passes;
+}
+
+int main() {
+  int maxThreads =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  std::vector<int> threadCounts;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  for (int count : {100000, 1000000, 10000000}) {
+    Registry viewRegistry;
+    Registry groupRegistry;
+    for (Registry *registry : {&viewRegistry, &groupRegistry}) {
+      std::vector<Entity> entities = registry->create(count);
+      for (Entity entity : entities) {
+        registry->addComponent(entity, Position(0, 0, 0));
+        registry->addComponent(entity, Velocity(1, 2, 3));
+      }
+    }
+    auto group = groupRegistry.group<Position, Velocity>();
+
+    std::printf("%d entities\n", count);
+    double viewBaseline = 0;
+    double groupBaseline = 0;
+    for (int threads : threadCounts) {
+      ThreadPool pool(threads - 1);
+      double viewMs = msPerPass(viewRegistry.view<Position, Velocity>(), pool);
+      double groupMs = msPerPass(group, pool);
+      if (threads == 1) {
+        viewBaseline = viewMs;
+        groupBaseline = groupMs;
+      }
+      std::printf("  %3d threads  view %8.3f ms (x%5.2f)  group %8.3f ms "
+                  "(x%5.2f)\n",
+                  threads, viewMs, viewBaseline / viewMs, groupMs,
+                  groupBaseline / groupMs);
+    }
+  }
+}
@@ -0,0 +1,101 @@
+// Cost of one GW_PROFILE_SCOPE, nested and flat, on the calling thread and
+// on pool workers, plus the time to fold a frame and export a trace. A scope
+// reads the timestamp twice, so the raw profileTicks() cost is shown too:
+// under virtualization the TSC read can trap and dominate.
+#define GW_PROFILE 1
+#include "profiler.cpp"
+#include "threadpool.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+const int SCOPES = 10000000;
+
+volatile int sink;
+
+double nsPerScope(int scopes) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < scopes; i++) {
+    GW_PROFILE_SCOPE("flat");
+    sink = i;
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         scopes;
+}
+
+double nsPerNestedScope(int scopes) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < scopes / 4; i++) {
+    GW_PROFILE_SCOPE("outer");
+    {
+      GW_PROFILE_SCOPE("middle");
+      {
+        GW_PROFILE_SCOPE("inner");
+        {
+          GW_PROFILE_SCOPE("leaf");
+          sink = i;
+        }
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         scopes;
+}
+
+double nsPerTimestamp(int reads) {
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reads; i++) {
+    sum += profileTicks();
+  }
+  auto end = std::chrono::steady_clock::now();
+  sink = static_cast<int>(sum);
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         reads;
+}
+
+double nsPerEmptyLoop(int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    sink = i;
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+int main() {
+  profiler().nameThread("main");
+  double loop = nsPerEmptyLoop(SCOPES);
+  std::printf("timestamp:    %6.2f ns\n", nsPerTimestamp(SCOPES));
+  std::printf("flat scope:   %6.2f ns\n", nsPerScope(SCOPES) - loop);
+  std::printf("nested scope: %6.2f ns\n", nsPerNestedScope(SCOPES) - loop / 4);
+
+  ThreadPool pool;
+  TaskGroup group;
+  auto start = std::chrono::steady_clock::now();
+  for (int task = 0; task < pool.concurrency(); task++) {
+    pool.submit(group, [] { nsPerScope(SCOPES / 4); });
+  }
+  pool.wait(group);
+  auto end = std::chrono::steady_clock::now();
+  std::printf("%d threads:    %6.2f ns per scope per thread\n",
+              pool.concurrency(),
+              std::chrono::duration<double, std::nano>(end - start).count() /
+                  (SCOPES / 4));
+
+  start = std::chrono::steady_clock::now();
+  profiler().endFrame();
+  end = std::chrono::steady_clock::now();
+  std::printf("endFrame:     %6.2f ms\n",
+              std::chrono::duration<double, std::milli>(end - start).count());
+
+  start = std::chrono::steady_clock::now();
+  bool written = profiler().writeChromeTrace("profiler_bench_trace.json");
+  end = std::chrono::steady_clock::now();
+  std::printf("trace export: %6.2f ms%s\n",
+              std::chrono::duration<double, std::milli>(end - start).count(),
+              written ? "" : " (failed)");
+}
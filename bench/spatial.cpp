@@ -0,0 +1,104 @@
+// Radius, box and k-nearest queries through SpatialIndex against a linear
+// scan of the Position storage, with 1M entities spread over a 1000^3 box.
+#include "motion.cpp"
+#include "position.cpp"
+#include "registry.cpp"
+#include "spatialindex.cpp"
+#include "velocity.cpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+template <typename Func> double msPerCall(Func func, int calls) {
+  auto start = std::chrono::steady_clock::now();
+  for (int call = 0; call < calls; call++) {
+    func(call);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         calls;
+}
+
+int main() {
+  const int count = 1000000;
+  const float extent = 1000.0f;
+  const float radius = 10.0f;
+
+  Registry registry;
+  std::vector<Entity> entities = registry.create(count);
+  std::vector<Position> positions;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> coordinate(0.0f, extent);
+  for (int i = 0; i < count; i++) {
+    positions.emplace_back(coordinate(rng), coordinate(rng), coordinate(rng));
+  }
+  registry.insert(entities.begin(), entities.end(), positions.data());
+
+  auto build = std::chrono::steady_clock::now();
+  SpatialIndex index(registry, 2 * radius);
+  std::printf("build %.1f ms\n",
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - build)
+                  .count());
+
+  std::vector<Vector3> centers;
+  for (int i = 0; i < 64; i++) {
+    centers.emplace_back(coordinate(rng), coordinate(rng), coordinate(rng));
+  }
+
+  std::vector<float> distances;
+  std::vector<Entity> found;
+  size_t scanHits = 0;
+  double scan = msPerCall(
+      [&](int call) {
+        positionDistancesSquared(registry, centers[call], distances);
+        for (float distance : distances) {
+          scanHits += distance <= radius * radius;
+        }
+      },
+      8);
+
+  size_t indexHits = 0;
+  double query = msPerCall(
+      [&](int call) {
+        index.queryRadius(centers[call % centers.size()], radius, found);
+        indexHits += found.size();
+      },
+      512);
+  std::printf("radius %.0f: linear scan %8.3f ms  index %8.4f ms  (%.0fx)\n",
+              radius, scan, query, scan / query);
+  std::printf("  hits per query: scan %.1f  index %.1f\n", scanHits / 8.0,
+              indexHits / 512.0);
+
+  double box = msPerCall(
+      [&](int call) {
+        Vector3 center = centers[call % centers.size()];
+        index.queryBox(Vector3(center.x - radius, center.y - radius,
+                               center.z - radius),
+                       Vector3(center.x + radius, center.y + radius,
+                               center.z + radius),
+                       found);
+      },
+      512);
+  double nearest = msPerCall(
+      [&](int call) { index.nearest(centers[call % centers.size()], 16, found); },
+      512);
+  std::printf("box %8.4f ms  16-nearest %8.4f ms\n", box, nearest);
+
+  std::vector<std::pair<Entity, Entity>> pairs;
+  double allPairs = msPerCall(
+      [&](int) { index.pairsWithin(2.0f, pairs); }, 4);
+  std::printf("pairs within 2: %zu in %.1f ms\n", pairs.size(), allPairs);
+
+  auto moving = registry.group<Position, Velocity>();
+  double refresh = msPerCall(
+      [&](int) {
+        integrateMotion(moving, 0.016f);
+        index.refresh();
+      },
+      4);
+  std::printf("refresh after integrate %.1f ms\n", refresh);
+}
@@ -0,0 +1,287 @@
+// Containers regression suite: add, remove, random get, view iteration,
+// churn and bulk insert/remove over 1k to 10M entities, for 4, 16 and 64
+// byte components. Every case reports the best ns per operation over a few
+// repetitions.
+//
+//   groundwork_bench [--out results.json] [--baseline baseline.json]
+//                    [--threshold 0.10] [--max-entities N] [--filter text]
+//
+// With --baseline, any case more than threshold slower than its baseline
+// entry is listed and the exit code is 1. The bench_compare target runs
+// that against bench/baseline.json; bench_baseline rewrites it.
+#include "registry.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+template <int Bytes> struct Payload {
+  float values[Bytes / sizeof(float)];
+
+  Payload(float value = 0) {
+    for (float &v : values) {
+      v = value;
+    }
+  }
+};
+
+// Second component for the two-component view case.
+struct Tag32 {
+  uint32_t value;
+};
+
+struct Result {
+  std::string name;
+  double nsPerOp;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Runs setup then measured count times and returns the best ns per op.
+// measured returns the number of operations it performed.
+double bestOf(int repetitions, const std::function<void()> &setup,
+              const std::function<long long()> &measured) {
+  double best = 1e300;
+  for (int rep = 0; rep < repetitions; rep++) {
+    setup();
+    auto start = Clock::now();
+    long long operations = measured();
+    auto end = Clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    best = std::min(best, ns / std::max(operations, 1LL));
+  }
+  return best;
+}
+
+// Keeps measured loops from being optimised away.
+volatile float sink;
+
+template <int Bytes>
+void runCases(int count, const std::string &filter,
+              std::vector<Result> &results) {
+  using Component = Payload<Bytes>;
+  int repetitions = std::clamp(2000000 / count, 3, 15);
+  std::string suffix =
+      "/" + std::to_string(Bytes) + "B/" + std::to_string(count);
+
+  std::mt19937 rng(42);
+  std::vector<Entity> entities;
+  std::vector<Entity> shuffled;
+  std::vector<Entity> live;
+  std::unique_ptr<Registry> registry;
+
+  auto fresh = [&](bool withComponents) {
+    registry = std::make_unique<Registry>();
+    entities = registry->create(count);
+    if (withComponents) {
+      registry->insert(entities.begin(), entities.end(), Component(1));
+    }
+    shuffled = entities;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+  };
+
+  auto run = [&](const char *name, const std::function<void()> &setup,
+                 const std::function<long long()> &measured) {
+    std::string full = name + suffix;
+    if (full.find(filter) == std::string::npos) {
+      return;
+    }
+    results.push_back({full, bestOf(repetitions, setup, measured)});
+    std::printf("%-32s %10.2f ns/op\n", full.c_str(), results.back().nsPerOp);
+    std::fflush(stdout);
+  };
+
+  run(
+      "add", [&] { fresh(false); },
+      [&] {
+        for (Entity entity : entities) {
+          registry->addComponent(entity, Component(2));
+        }
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "remove", [&] { fresh(true); },
+      [&] {
+        for (Entity entity : shuffled) {
+          registry->removeComponent<Component>(entity);
+        }
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "get_random", [&] { fresh(true); },
+      [&] {
+        float sum = 0;
+        for (Entity entity : shuffled) {
+          sum += registry->getComponent<Component>(entity)->values[0];
+        }
+        sink = sum;
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "view2",
+      [&] {
+        fresh(true);
+        registry->insert(entities.begin(), entities.end(), Tag32{3});
+      },
+      [&] {
+        float sum = 0;
+        registry->view<Component, Tag32>().each(
+            [&](const Component &component, const Tag32 &tag) {
+              sum += component.values[0] + tag.value;
+            });
+        sink = sum;
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "churn",
+      [&] {
+        fresh(true);
+        live = shuffled;
+      },
+      [&] {
+        // Destroy a random live entity and spawn a replacement, so indices
+        // recycle and the dense arrays keep getting swap-removed.
+        for (int i = 0; i < count; i++) {
+          Entity &victim = live[rng() % live.size()];
+          registry->destroy(victim);
+          victim = registry->create();
+          registry->addComponent(victim, Component(4));
+        }
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "bulk_insert", [&] { fresh(false); },
+      [&] {
+        registry->insert(entities.begin(), entities.end(), Component(5));
+        return static_cast<long long>(count);
+      });
+
+  run(
+      "bulk_remove", [&] { fresh(true); },
+      [&] {
+        registry->remove<Component>(entities.begin(), entities.end());
+        return static_cast<long long>(count);
+      });
+}
+
+void writeJson(const std::string &path, const std::vector<Result> &results) {
+  std::ofstream out(path);
+  out << "{\n  \"results\": [\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    out << "    {\"name\": \"" << results[i].name
+        << "\", \"ns_per_op\": " << results[i].nsPerOp << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+// Reads back the name/ns_per_op pairs writeJson produces.
+std::map<std::string, double> readJson(const std::string &path) {
+  std::map<std::string, double> entries;
+  std::ifstream in(path);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  std::string text = buffer.str();
+
+  std::size_t position = 0;
+  const std::string nameKey = "\"name\": \"";
+  const std::string valueKey = "\"ns_per_op\": ";
+  while ((position = text.find(nameKey, position)) != std::string::npos) {
+    position += nameKey.size();
+    std::size_t nameEnd = text.find('"', position);
+    std::size_t value = text.find(valueKey, nameEnd);
+    if (nameEnd == std::string::npos || value == std::string::npos) {
+      break;
+    }
+    entries[text.substr(position, nameEnd - position)] =
+        std::strtod(text.c_str() + value + valueKey.size(), nullptr);
+    position = value;
+  }
+  return entries;
+}
+
+int main(int argc, char **argv) {
+  std::string out;
+  std::string baseline;
+  std::string filter;
+  double threshold = 0.10;
+  long long maxEntities = 10000000;
+
+  for (int i = 1; i < argc; i += 2) {
+    std::string flag = argv[i];
+    if (i + 1 == argc) {
+      std::fprintf(stderr, "flag %s needs a value\n", flag.c_str());
+      return 2;
+    }
+    if (flag == "--out") {
+      out = argv[i + 1];
+    } else if (flag == "--baseline") {
+      baseline = argv[i + 1];
+    } else if (flag == "--threshold") {
+      threshold = std::atof(argv[i + 1]);
+    } else if (flag == "--max-entities") {
+      maxEntities = std::atoll(argv[i + 1]);
+    } else if (flag == "--filter") {
+      filter = argv[i + 1];
+    } else {
+      std::fprintf(stderr, "unknown flag %s\n", flag.c_str());
+      return 2;
+    }
+  }
+
+  std::vector<Result> results;
+  for (int count : {1000, 10000, 100000, 1000000, 10000000}) {
+    if (count > maxEntities) {
+      break;
+    }
+    runCases<4>(count, filter, results);
+    runCases<16>(count, filter, results);
+    runCases<64>(count, filter, results);
+  }
+
+  if (!out.empty()) {
+    writeJson(out, results);
+  }
+
+  if (baseline.empty()) {
+    return 0;
+  }
+
+  std::map<std::string, double> expected = readJson(baseline);
+  if (expected.empty()) {
+    std::fprintf(stderr, "no results in baseline %s\n", baseline.c_str());
+    return 2;
+  }
+
+  int regressions = 0;
+  for (const Result &result : results) {
+    auto found = expected.find(result.name);
+    if (found == expected.end()) {
+      continue;
+    }
+    double change = result.nsPerOp / found->second - 1.0;
+    if (change > threshold) {
+      std::printf("REGRESSION %-32s %10.2f -> %10.2f ns/op (+%.0f%%)\n",
+                  result.name.c_str(), found->second, result.nsPerOp,
+                  change * 100);
+      regressions++;
+    }
+  }
+  std::printf("%d regression(s) over %.0f%% against %s\n", regressions,
+              threshold * 100, baseline.c_str());
+  return regressions > 0 ? 1 : 0;
+}
@@ -1,11 +1,21 @@
 #version 450
 
+layout(push_constant) uniform View {
+    vec2 center;
+    vec2 scale;
+} view;
+
 layout(location=0) in vec2 inPosition;
 layout(location=1) in vec3 inColor;
 
+// Per instance: world position in xyz, uniform scale in w, then the tint.
+layout(location=2) in vec4 instancePosition;
+layout(location=3) in vec4 instanceColor;
+
 layout(location=0) out vec3 fragColor;
 
 void main() {
-    gl_position = vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
-}
\ No newline at end of file
+    vec2 world = instancePosition.xy + inPosition * instancePosition.w;
+    gl_Position = vec4((world - view.center) * view.scale, 0.0, 1.0);
+    fragColor = inColor * instanceColor.rgb;
+}
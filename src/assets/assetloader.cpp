@@ -0,0 +1,292 @@
+#pragma once
+
+#include "mappedfile.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Higher priorities are mapped first.
+enum class AssetPriority { Low, Normal, High };
+
+// A whole file mapped read-only, with a hash of its contents. The bytes stay
+// valid, and zero-copy, for as long as any handle to the asset lives.
+struct Asset {
+  std::string path;
+  MappedFile file;
+  uint64_t hash = 0;
+
+  explicit Asset(const std::string &path) : path(path), file(path) {}
+
+  const unsigned char *data() const { return file.data; }
+  uint64_t size() const { return file.size; }
+};
+
+// Null when the file is missing or empty.
+using AssetHandle = std::shared_ptr<const Asset>;
+
+// 64-bit FNV-1a over 8-byte words, with the byte-wise tail. Also faults the
+// mapping in, so that happens on the loading thread rather than the reader.
+inline uint64_t assetContentHash(const unsigned char *data, uint64_t size) {
+  const uint64_t prime = 0x100000001b3ull;
+  uint64_t hash = 0xcbf29ce484222325ull ^ size;
+  uint64_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < size; i++) {
+    hash = (hash ^ data[i]) * prime;
+  }
+  return hash;
+}
+
+// Maps files on its own I/O threads, highest priority first, and hands the
+// results out through shared futures. Asking for a path again returns the
+// first request's future; files whose contents hash the same as a live
+// asset resolve to that asset, so duplicate data is mapped only once.
+//
+// Separate from the job ThreadPool on purpose: page faults block, and
+// ThreadPool::wait would otherwise pull I/O onto the waiting thread.
+struct AssetLoader {
+  explicit AssetLoader(int threadCount = 2) {
+    for (int i = 0; i < std::max(threadCount, 1); i++) {
+      threads.emplace_back([this] { ioLoop(); });
+    }
+  }
+
+  // Requests still queued resolve to null.
+  ~AssetLoader() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    while (!queue.empty()) {
+      std::shared_ptr<Request> request = queue.top().request;
+      queue.pop();
+      if (!request->started) {
+        request->started = true;
+        request->promise.set_value(nullptr);
+      }
+    }
+  }
+
+  AssetLoader(const AssetLoader &) = delete;
+  AssetLoader &operator=(const AssetLoader &) = delete;
+
+  // Asking again for a queued path at a higher priority moves it forward.
+  std::shared_future<AssetHandle>
+  load(const std::string &path,
+       AssetPriority priority = AssetPriority::Normal) {
+    std::lock_guard<std::mutex> lock(mutex);
+    requestCount++;
+
+    auto found = requests.find(path);
+    if (found != requests.end()) {
+      pathHitCount++;
+      std::shared_ptr<Request> &request = found->second;
+      if (!request->started && priority > request->priority) {
+        request->priority = priority;
+        queue.push({priority, sequence++, request});
+        wakeIdleThread();
+      }
+      return request->future;
+    }
+
+    std::shared_ptr<Request> request = addRequest(path, priority);
+    queue.push({priority, sequence++, request});
+    wakeIdleThread();
+    return request->future;
+  }
+
+  // Maps path on the calling thread, through the same caches. A request an
+  // I/O thread has not picked up yet is taken over; one it is already
+  // mapping is waited for.
+  AssetHandle loadNow(const std::string &path) {
+    std::shared_ptr<Request> request;
+    bool claimed = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      requestCount++;
+      auto found = requests.find(path);
+      if (found != requests.end()) {
+        pathHitCount++;
+        request = found->second;
+      } else {
+        request = addRequest(path, AssetPriority::High);
+      }
+      // Queued entries for a started request are skipped.
+      if (!request->started) {
+        request->started = true;
+        claimed = true;
+      }
+    }
+    if (claimed) {
+      request->promise.set_value(map(path));
+    }
+    return request->future.get();
+  }
+
+  // Forgets every path whose asset nobody outside the loader holds,
+  // unmapping it. Paths whose contents matched share one asset, so it is
+  // only released once every one of them is forgotten. Requests still in
+  // flight are kept.
+  void trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<const Asset *, long> held;
+    for (const auto &entry : requests) {
+      if (isDone(*entry.second)) {
+        held[entry.second->future.get().get()]++;
+      }
+    }
+    for (auto it = requests.begin(); it != requests.end();) {
+      Request &request = *it->second;
+      if (isDone(request)) {
+        const AssetHandle &asset = request.future.get();
+        if (!asset || asset.use_count() <= held[asset.get()]) {
+          it = requests.erase(it);
+          continue;
+        }
+      }
+      ++it;
+    }
+  }
+
+  struct Stats {
+    uint64_t requests = 0;
+    // Requests answered by an earlier request for the same path.
+    uint64_t pathHits = 0;
+    // Files mapped, then dropped for an identical live asset.
+    uint64_t contentHits = 0;
+    uint64_t bytesMapped = 0;
+  };
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return {requestCount, pathHitCount, contentHitCount, mappedBytes};
+  }
+
+private:
+  struct Request {
+    std::string path;
+    AssetPriority priority;
+    bool started = false;
+    std::promise<AssetHandle> promise;
+    std::shared_future<AssetHandle> future;
+  };
+
+  // A request is queued once per priority it was asked for; the first
+  // entry popped runs it and the rest are skipped.
+  struct Queued {
+    AssetPriority priority;
+    uint64_t sequence;
+    std::shared_ptr<Request> request;
+
+    bool operator<(const Queued &other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      return sequence > other.sequence;
+    }
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  int idleThreads = 0;
+  std::vector<std::thread> threads;
+
+  std::priority_queue<Queued> queue;
+  uint64_t sequence = 0;
+  std::unordered_map<std::string, std::shared_ptr<Request>> requests;
+  std::unordered_map<uint64_t, std::weak_ptr<const Asset>> byContent;
+
+  uint64_t requestCount = 0;
+  uint64_t pathHitCount = 0;
+  uint64_t contentHitCount = 0;
+  uint64_t mappedBytes = 0;
+
+  void ioLoop() {
+    while (true) {
+      std::shared_ptr<Request> request;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        idleThreads++;
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        idleThreads--;
+        if (stopping) {
+          return;
+        }
+        request = queue.top().request;
+        queue.pop();
+        if (request->started) {
+          continue;
+        }
+        request->started = true;
+      }
+      request->promise.set_value(map(request->path));
+    }
+  }
+
+  // Registers a request for path without queueing it. Called with mutex
+  // held.
+  std::shared_ptr<Request> addRequest(const std::string &path,
+                                      AssetPriority priority) {
+    auto request = std::make_shared<Request>();
+    request->path = path;
+    request->priority = priority;
+    request->future = request->promise.get_future().share();
+    requests.emplace(path, request);
+    return request;
+  }
+
+  static bool isDone(const Request &request) {
+    return request.future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  }
+
+  // Busy threads come back to the queue on their own; only sleeping ones
+  // need the syscall. Called with mutex held.
+  void wakeIdleThread() {
+    if (idleThreads > 0) {
+      wake.notify_one();
+    }
+  }
+
+  AssetHandle map(const std::string &path) {
+    auto asset = std::make_shared<Asset>(path);
+    if (asset->data() == nullptr) {
+      return nullptr;
+    }
+    asset->hash = assetContentHash(asset->data(), asset->size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    mappedBytes += asset->size();
+    std::weak_ptr<const Asset> &existing = byContent[asset->hash];
+    if (AssetHandle same = existing.lock()) {
+      if (same->size() == asset->size() &&
+          std::memcmp(same->data(), asset->data(), asset->size()) == 0) {
+        contentHitCount++;
+        return same;
+      }
+    }
+    existing = asset;
+    return asset;
+  }
+};
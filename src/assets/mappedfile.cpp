@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only mapping of a whole file. data is null if it could not be opened.
+struct MappedFile {
+  const unsigned char *data = nullptr;
+  uint64_t size = 0;
+  // Whether the OS took the sequential read-ahead hints.
+  bool advised = false;
+
+  explicit MappedFile(const std::string &path) {
+#if defined(_WIN32)
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+      return;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+      return;
+    }
+    data = static_cast<const unsigned char *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    size = data != nullptr ? static_cast<uint64_t>(length.QuadPart) : 0;
+    advised = data != nullptr;
+#else
+    descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor == -1) {
+      return;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+      return;
+    }
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                        descriptor, 0);
+    if (mapped == MAP_FAILED) {
+      return;
+    }
+    // Readers walk the file front to back, usually exactly once. Advice
+    // values are not flags, so each takes its own call; a refusal only
+    // costs read-ahead, so the mapping is kept either way.
+    bool sequential = madvise(mapped, info.st_size, MADV_SEQUENTIAL) == 0;
+    bool willNeed = madvise(mapped, info.st_size, MADV_WILLNEED) == 0;
+    advised = sequential && willNeed;
+    data = static_cast<const unsigned char *>(mapped);
+    size = static_cast<uint64_t>(info.st_size);
+#endif
+  }
+
+  ~MappedFile() {
+#if defined(_WIN32)
+    if (data != nullptr) {
+      UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr) {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+#else
+    if (data != nullptr) {
+      munmap(const_cast<unsigned char *>(data), size);
+    }
+    if (descriptor != -1) {
+      close(descriptor);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+#if defined(_WIN32)
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int descriptor = -1;
+#endif
+};
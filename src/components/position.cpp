@@ -1,5 +1,41 @@
+#pragma once
+
+#include "../containers/soa.cpp"
 
 struct Position {
   float x, y, z;
   Position(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}
 };
+
+// Stored as separate x, y and z streams so batch kernels use full vector
+// lanes; getComponent and views hand out a Reference proxy.
+template <> struct SoATraits<Position> {
+  static constexpr bool enabled = true;
+  using Scalar = float;
+  static constexpr int streamCount = 3;
+
+  struct Reference {
+    float &x;
+    float &y;
+    float &z;
+
+    operator Position() const { return Position(x, y, z); }
+
+    Reference &operator=(const Position &position) {
+      x = position.x;
+      y = position.y;
+      z = position.z;
+      return *this;
+    }
+
+    Reference(const Reference &) = default;
+
+    Reference &operator=(const Reference &other) {
+      return *this = static_cast<Position>(other);
+    }
+
+    Reference *operator->() { return this; }
+  };
+};
+
+using PositionRef = SoATraits<Position>::Reference;
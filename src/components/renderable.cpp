@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Makes an entity with a Position visible: drawn with mesh, scaled
+// uniformly and tinted by r, g, b.
+struct Renderable {
+  uint32_t mesh;
+  float scale;
+  float r, g, b;
+  Renderable(uint32_t mesh = 0, float scale = 1, float r = 1, float g = 1,
+             float b = 1)
+      : mesh(mesh), scale(scale), r(r), g(g), b(b) {}
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../containers/soa.cpp"
+
+struct Velocity {
+  float x, y, z;
+  Velocity(float x = 0, float y = 0, float z = 0) : x(x), y(y), z(z) {}
+};
+
+// Same x, y, z stream layout as Position, so the two line up for the
+// integration kernels.
+template <> struct SoATraits<Velocity> {
+  static constexpr bool enabled = true;
+  using Scalar = float;
+  static constexpr int streamCount = 3;
+
+  struct Reference {
+    float &x;
+    float &y;
+    float &z;
+
+    operator Velocity() const { return Velocity(x, y, z); }
+
+    Reference &operator=(const Velocity &velocity) {
+      x = velocity.x;
+      y = velocity.y;
+      z = velocity.z;
+      return *this;
+    }
+
+    Reference(const Reference &) = default;
+
+    Reference &operator=(const Reference &other) {
+      return *this = static_cast<Velocity>(other);
+    }
+
+    Reference *operator->() { return this; }
+  };
+};
+
+using VelocityRef = SoATraits<Velocity>::Reference;
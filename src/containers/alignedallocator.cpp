@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+const std::size_t CACHE_LINE_SIZE = 64;
+
+// Allocates every array on a cache-line boundary, so a range of elements
+// starting at a multiple of CACHE_LINE_SIZE bytes owns whole lines.
+template <typename T> struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U> AlignedAllocator(const AlignedAllocator<U> &) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(::operator new(
+        count * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+  }
+
+  void deallocate(T *pointer, std::size_t) {
+    ::operator delete(pointer, std::align_val_t(CACHE_LINE_SIZE));
+  }
+
+  template <typename U> bool operator==(const AlignedAllocator<U> &) const {
+    return true;
+  }
+  template <typename U> bool operator!=(const AlignedAllocator<U> &) const {
+    return false;
+  }
+};
+
+// The allocator a container templated on Allocator uses for its U arrays.
+template <typename Allocator, typename U>
+using RebindAllocator =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+template <typename Allocator, typename = void>
+struct ReportsAllocationSize : std::false_type {};
+template <typename Allocator>
+struct ReportsAllocationSize<
+    Allocator, std::void_t<decltype(std::declval<const Allocator &>()
+                                        .allocationSize(std::size_t()))>>
+    : std::true_type {};
+
+// Bytes allocator really takes for count elements. Allocators that round
+// requests up, like PagePoolAllocator, say so through allocationSize.
+template <typename Allocator>
+std::size_t allocatedBytes(const Allocator &allocator, std::size_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  if constexpr (ReportsAllocationSize<Allocator>::value) {
+    return allocator.allocationSize(count);
+  } else {
+    return count * sizeof(typename Allocator::value_type);
+  }
+}
+
+// Bytes held by a vector's buffer, spare capacity included.
+template <typename Vector> std::size_t capacityBytes(const Vector &vector) {
+  return allocatedBytes(vector.get_allocator(), vector.capacity());
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "componenttype.cpp"
+#include "entity.cpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+const int ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+// What an archetype needs to move and destroy a component it only knows by
+// type ID.
+struct ComponentInfo {
+  int id;
+  std::size_t size;
+  std::size_t align;
+  void (*moveConstruct)(void *destination, void *source);
+  void (*destroy)(void *component);
+};
+
+template <typename T> const ComponentInfo *componentInfo() {
+  static const ComponentInfo info = {
+      componentTypeId<T>(), sizeof(T), alignof(T),
+      [](void *destination, void *source) {
+        new (destination) T(std::move(*static_cast<T *>(source)));
+      },
+      [](void *component) { static_cast<T *>(component)->~T(); }};
+  return &info;
+}
+
+// 64-byte aligned storage for one chunk, normally ARCHETYPE_CHUNK_SIZE bytes.
+struct ArchetypeChunk {
+  unsigned char *bytes;
+
+  explicit ArchetypeChunk(std::size_t size)
+      : bytes(static_cast<unsigned char *>(
+            ::operator new(size, std::align_val_t(64)))) {}
+
+  ~ArchetypeChunk() { ::operator delete(bytes, std::align_val_t(64)); }
+
+  ArchetypeChunk(const ArchetypeChunk &) = delete;
+  ArchetypeChunk &operator=(const ArchetypeChunk &) = delete;
+};
+
+// All entities with exactly the same component set. Each chunk is laid out
+// structure-of-arrays: an Entity column followed by one column per component,
+// each chunkCapacity elements long. Rows are kept packed, so every chunk but
+// the last is full and row r lives in chunk r / chunkCapacity.
+struct Archetype {
+  // Sorted by ComponentInfo::id.
+  std::vector<const ComponentInfo *> components;
+  std::vector<std::size_t> offsets;
+  int chunkCapacity = 0;
+  // Bytes per chunk: ARCHETYPE_CHUNK_SIZE, or exactly one row for rows
+  // that don't fit in that.
+  std::size_t chunkBytes = ARCHETYPE_CHUNK_SIZE;
+  int count = 0;
+  std::vector<std::unique_ptr<ArchetypeChunk>> chunks;
+
+  // Cached transitions to the archetype with one component type added or
+  // removed, keyed by that type's ID.
+  std::unordered_map<int, Archetype *> addEdges;
+  std::unordered_map<int, Archetype *> removeEdges;
+
+  explicit Archetype(std::vector<const ComponentInfo *> infos)
+      : components(std::move(infos)) {
+    std::size_t rowSize = sizeof(Entity);
+    for (const ComponentInfo *info : components) {
+      rowSize += info->size;
+    }
+
+    // Start from the unpadded estimate and shrink until the aligned columns
+    // fit in a chunk. A row too big for any chunk gets chunks of its own.
+    chunkCapacity =
+        std::max(1, static_cast<int>(ARCHETYPE_CHUNK_SIZE / rowSize));
+    while (chunkCapacity > 1 && layout() > ARCHETYPE_CHUNK_SIZE) {
+      chunkCapacity--;
+    }
+    chunkBytes =
+        std::max(layout(), static_cast<std::size_t>(ARCHETYPE_CHUNK_SIZE));
+  }
+
+  ~Archetype() {
+    for (int row = 0; row < count; row++) {
+      for (int column = 0; column < static_cast<int>(components.size());
+           column++) {
+        components[column]->destroy(component(row, column));
+      }
+    }
+  }
+
+  Archetype(const Archetype &) = delete;
+  Archetype &operator=(const Archetype &) = delete;
+
+  int column(int typeId) const {
+    int low = 0;
+    int high = static_cast<int>(components.size()) - 1;
+    while (low <= high) {
+      int mid = (low + high) / 2;
+      if (components[mid]->id == typeId) {
+        return mid;
+      }
+      if (components[mid]->id < typeId) {
+        low = mid + 1;
+      } else {
+        high = mid - 1;
+      }
+    }
+    return -1;
+  }
+
+  int rowsInChunk(int chunk) const {
+    if (chunk + 1 < static_cast<int>(chunks.size())) {
+      return chunkCapacity;
+    }
+    return count - chunk * chunkCapacity;
+  }
+
+  Entity *entities(int chunk) {
+    return reinterpret_cast<Entity *>(chunks[chunk]->bytes);
+  }
+
+  void *columnData(int chunk, int column) {
+    return chunks[chunk]->bytes + offsets[column];
+  }
+
+  Entity &entityAt(int row) {
+    return entities(row / chunkCapacity)[row % chunkCapacity];
+  }
+
+  void *component(int row, int column) {
+    return static_cast<unsigned char *>(
+               columnData(row / chunkCapacity, column)) +
+           (row % chunkCapacity) * components[column]->size;
+  }
+
+  // Appends a row for entity with its component slots left unconstructed.
+  int allocateRow(Entity entity) {
+    if (count == static_cast<int>(chunks.size()) * chunkCapacity) {
+      chunks.push_back(std::make_unique<ArchetypeChunk>(chunkBytes));
+    }
+    entityAt(count) = entity;
+    return count++;
+  }
+
+  // Destroys the components in row and moves the last row into the hole.
+  // Returns the entity that now lives in row, or NULL_ENTITY if row was last.
+  Entity removeRow(int row) {
+    int last = count - 1;
+    for (int column = 0; column < static_cast<int>(components.size());
+         column++) {
+      components[column]->destroy(component(row, column));
+      if (row != last) {
+        components[column]->moveConstruct(component(row, column),
+                                          component(last, column));
+        components[column]->destroy(component(last, column));
+      }
+    }
+
+    Entity moved = NULL_ENTITY;
+    if (row != last) {
+      moved = entityAt(last);
+      entityAt(row) = moved;
+    }
+
+    count--;
+    if (count <= (static_cast<int>(chunks.size()) - 1) * chunkCapacity) {
+      chunks.pop_back();
+    }
+    return moved;
+  }
+
+private:
+  // Lays the columns out for chunkCapacity rows and returns the bytes used.
+  std::size_t layout() {
+    offsets.clear();
+    std::size_t end = sizeof(Entity) * chunkCapacity;
+    for (const ComponentInfo *info : components) {
+      std::size_t offset = (end + info->align - 1) / info->align * info->align;
+      offsets.push_back(offset);
+      end = offset + info->size * chunkCapacity;
+    }
+    return end;
+  }
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "archetype.cpp"
+#include "componenttype.cpp"
+#include "entity.cpp"
+#include "view.cpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct ArchetypeRegistry;
+
+// Visits every archetype holding all of Get... and none of Exclude...,
+// walking each chunk's columns linearly.
+template <typename Excludes, typename... Get> struct ArchetypeView;
+
+template <typename... Exclude, typename... Get>
+struct ArchetypeView<ExcludeList<Exclude...>, Get...> {
+  std::vector<Archetype *> archetypes;
+
+  // func is called as func(entity, Get&...) or func(Get&...).
+  template <typename Func> void each(Func func) {
+    for (Archetype *archetype : archetypes) {
+      int columns[] = {archetype->column(componentTypeId<Get>())...};
+      for (int chunk = 0; chunk < static_cast<int>(archetype->chunks.size());
+           chunk++) {
+        eachInChunk(func, *archetype, chunk, columns,
+                    std::index_sequence_for<Get...>{});
+      }
+    }
+  }
+
+private:
+  template <typename Func, std::size_t... I>
+  void eachInChunk(Func &func, Archetype &archetype, int chunk,
+                   const int *columns, std::index_sequence<I...>) {
+    Entity *entities = archetype.entities(chunk);
+    std::tuple<Get *...> data{
+        static_cast<Get *>(archetype.columnData(chunk, columns[I]))...};
+    int rows = archetype.rowsInChunk(chunk);
+
+    for (int row = 0; row < rows; row++) {
+      if constexpr (std::is_invocable_v<Func &, Entity, Get &...>) {
+        func(entities[row], std::get<I>(data)[row]...);
+      } else {
+        func(std::get<I>(data)[row]...);
+      }
+    }
+  }
+};
+
+// Drop-in alternative to Registry that groups entities by their exact
+// component set into archetypes. Iterating several components reads parallel
+// columns of the same chunk instead of several unrelated storages, at the
+// cost of moving the entity's components whenever its set changes.
+struct ArchetypeRegistry {
+public:
+  ArchetypeRegistry() { root = findArchetype({}); }
+
+  Entity create() {
+    flushReserved();
+    Entity entity = entityPool.create();
+    place(entity, root);
+    return entity;
+  }
+
+  std::vector<Entity> create(int count) {
+    flushReserved();
+    std::vector<Entity> created = entityPool.create(count);
+    for (Entity entity : created) {
+      place(entity, root);
+    }
+    return created;
+  }
+
+  // Archetypes keep no per-component change ticks; the tick is only counted
+  // so systems see the same frame numbering as on Registry.
+  uint32_t tick() const { return currentTick; }
+  uint32_t advanceTick() { return ++currentTick; }
+
+  // Same contract as Registry::lockStorages, for archetypes.
+  void lockStorages(bool locked) { storagesLocked = locked; }
+
+  // Same contract as Registry::reserve.
+  Entity reserve() { return entityPool.reserve(); }
+
+  void flushReserved() {
+    uint32_t first = entityPool.flushReserved();
+    for (uint32_t index = first; index < entityPool.entities.size(); index++) {
+      place(entityPool.entities[index], root);
+    }
+  }
+
+  void destroy(Entity entity) {
+    if (!valid(entity)) {
+      return;
+    }
+
+    EntityLocation &location = locations[entityIndex(entity)];
+    removeRow(*location.archetype, location.row);
+    location.archetype = nullptr;
+    entityPool.release(entity);
+  }
+
+  bool valid(Entity entity) const { return entityPool.valid(entity); }
+
+  template <typename T> void addComponent(Entity entityID, const T &component) {
+    if (!valid(entityID)) {
+      return;
+    }
+
+    EntityLocation &location = locations[entityIndex(entityID)];
+    int typeId = componentTypeId<T>();
+    int column = location.archetype->column(typeId);
+    if (column != -1) {
+      *static_cast<T *>(location.archetype->component(location.row, column)) =
+          component;
+      return;
+    }
+
+    Archetype *target = location.archetype->addEdges[typeId];
+    if (target == nullptr) {
+      target = withComponent(*location.archetype, componentInfo<T>());
+      location.archetype->addEdges[typeId] = target;
+    }
+
+    move(entityID, *target);
+    new (target->component(location.row, target->column(typeId)))
+        T(component);
+  }
+
+  template <typename T> void removeComponent(Entity entityID) {
+    if (!valid(entityID)) {
+      return;
+    }
+
+    EntityLocation &location = locations[entityIndex(entityID)];
+    int typeId = componentTypeId<T>();
+    if (location.archetype->column(typeId) == -1) {
+      return;
+    }
+
+    Archetype *target = location.archetype->removeEdges[typeId];
+    if (target == nullptr) {
+      target = withoutComponent(*location.archetype, typeId);
+      location.archetype->removeEdges[typeId] = target;
+    }
+
+    move(entityID, *target);
+  }
+
+  // Per-entity loops; here every add or remove moves the entity between
+  // archetypes anyway, so there is nothing to batch.
+  template <typename T, typename It>
+  void insert(It first, It last, const T *components) {
+    for (; first != last; ++first, ++components) {
+      addComponent(*first, *components);
+    }
+  }
+
+  template <typename T, typename It> void remove(It first, It last) {
+    for (; first != last; ++first) {
+      removeComponent<T>(*first);
+    }
+  }
+
+  template <typename T> T *getComponent(Entity entityID) {
+    if (!valid(entityID)) {
+      return nullptr;
+    }
+
+    EntityLocation &location = locations[entityIndex(entityID)];
+    int column = location.archetype->column(componentTypeId<T>());
+    if (column == -1) {
+      return nullptr;
+    }
+    return static_cast<T *>(location.archetype->component(location.row, column));
+  }
+
+  template <typename... Get, typename... Exclude>
+  ArchetypeView<ExcludeList<Exclude...>, Get...>
+  view(ExcludeList<Exclude...> = ExcludeList<Exclude...>{}) {
+    ArchetypeView<ExcludeList<Exclude...>, Get...> result;
+    for (auto &entry : archetypes) {
+      Archetype &archetype = *entry.second;
+      if (archetype.count > 0 &&
+          ((archetype.column(componentTypeId<Get>()) != -1) && ...) &&
+          ((archetype.column(componentTypeId<Exclude>()) == -1) && ...)) {
+        result.archetypes.push_back(&archetype);
+      }
+    }
+    return result;
+  }
+
+private:
+  struct EntityLocation {
+    Archetype *archetype = nullptr;
+    int row = 0;
+  };
+
+  EntityPool entityPool;
+  std::vector<EntityLocation> locations;
+
+  // Keyed by the sorted component type IDs of the archetype.
+  std::map<std::vector<int>, std::unique_ptr<Archetype>> archetypes;
+  Archetype *root = nullptr;
+
+  uint32_t currentTick = 1;
+  bool storagesLocked = false;
+
+  void place(Entity entity, Archetype *archetype) {
+    uint32_t index = entityIndex(entity);
+    if (index >= locations.size()) {
+      locations.resize(index + 1);
+    }
+    locations[index].archetype = archetype;
+    locations[index].row = archetype->allocateRow(entity);
+  }
+
+  void removeRow(Archetype &archetype, int row) {
+    Entity moved = archetype.removeRow(row);
+    if (moved != NULL_ENTITY) {
+      locations[entityIndex(moved)].row = row;
+    }
+  }
+
+  // Moves entity's components that exist in target over to a new row there.
+  // Components target lacks are destroyed; slots source lacks are left for
+  // the caller to construct.
+  void move(Entity entity, Archetype &target) {
+    EntityLocation &location = locations[entityIndex(entity)];
+    Archetype &source = *location.archetype;
+    int row = target.allocateRow(entity);
+
+    for (int column = 0; column < static_cast<int>(source.components.size());
+         column++) {
+      int targetColumn = target.column(source.components[column]->id);
+      if (targetColumn != -1) {
+        source.components[column]->moveConstruct(
+            target.component(row, targetColumn),
+            source.component(location.row, column));
+      }
+    }
+
+    removeRow(source, location.row);
+    location.archetype = &target;
+    location.row = row;
+  }
+
+  Archetype *withComponent(const Archetype &source, const ComponentInfo *info) {
+    std::vector<const ComponentInfo *> infos = source.components;
+    infos.insert(std::lower_bound(infos.begin(), infos.end(), info,
+                                  [](const ComponentInfo *a,
+                                     const ComponentInfo *b) {
+                                    return a->id < b->id;
+                                  }),
+                 info);
+    return findArchetype(std::move(infos));
+  }
+
+  Archetype *withoutComponent(const Archetype &source, int typeId) {
+    std::vector<const ComponentInfo *> infos;
+    for (const ComponentInfo *info : source.components) {
+      if (info->id != typeId) {
+        infos.push_back(info);
+      }
+    }
+    return findArchetype(std::move(infos));
+  }
+
+  Archetype *findArchetype(std::vector<const ComponentInfo *> infos) {
+    std::vector<int> key;
+    for (const ComponentInfo *info : infos) {
+      key.push_back(info->id);
+    }
+
+    std::unique_ptr<Archetype> &archetype = archetypes[key];
+    if (!archetype) {
+      assert(!storagesLocked &&
+             "structural changes while systems run go through commands");
+      archetype = std::make_unique<Archetype>(std::move(infos));
+    }
+    return archetype.get();
+  }
+};
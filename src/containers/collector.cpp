@@ -0,0 +1,64 @@
+#pragma once
+
+#include "registry.cpp"
+#include "sparseset.cpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+enum CollectEvent : uint32_t {
+  COLLECT_CONSTRUCT = 1 << 0,
+  COLLECT_UPDATE = 1 << 1,
+};
+
+// Gathers the entities whose observed components were constructed or
+// updated into a compact set, so an incremental system walks only those
+// and then clears it. An entity losing an observed component drops out.
+struct Collector {
+  SparseSet entities;
+
+  Collector() = default;
+  Collector(const Collector &) = delete;
+  Collector &operator=(const Collector &) = delete;
+
+  ~Collector() {
+    for (auto &connection : connections) {
+      connection.first->disconnect(connection.second);
+    }
+  }
+
+  // The collector must not outlive registry.
+  template <typename T>
+  Collector &observe(Registry &registry,
+                     uint32_t events = COLLECT_CONSTRUCT | COLLECT_UPDATE) {
+    auto &storage = registry.storage<T>();
+    auto collect = [this](Entity entity) { entities.add(entity); };
+    if (events & COLLECT_CONSTRUCT) {
+      connect(storage.onConstruct, collect);
+    }
+    if (events & COLLECT_UPDATE) {
+      connect(storage.onUpdate, collect);
+    }
+    connect(storage.onDestroy,
+            [this](Entity entity) { entities.remove(entity); });
+    return *this;
+  }
+
+  int size() const { return entities.size(); }
+
+  template <typename Func> void each(Func func) const {
+    for (Entity entity : entities.dense) {
+      func(entity);
+    }
+  }
+
+  void clear() { entities.clear(); }
+
+private:
+  std::vector<std::pair<Signal *, int>> connections;
+
+  template <typename Listener> void connect(Signal &signal, Listener listener) {
+    connections.emplace_back(&signal, signal.connect(std::move(listener)));
+  }
+};
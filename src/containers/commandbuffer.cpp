@@ -0,0 +1,197 @@
+#pragma once
+
+#include "../jobs/threadpool.cpp"
+#include "componenttype.cpp"
+#include "entity.cpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+template <typename Backend> struct PendingCommandsBase {
+  virtual ~PendingCommandsBase() = default;
+  virtual bool empty() const = 0;
+  virtual void clear() = 0;
+
+  // Applies the commands of every buffer in pending, all of which hold the
+  // same component type as this one.
+  virtual void apply(Backend &registry,
+                     const std::vector<PendingCommandsBase *> &pending) = 0;
+};
+
+// The adds and removes of one component type recorded by one buffer, in
+// recording order. valueIndex is -1 for a remove.
+template <typename Backend, typename T>
+struct PendingCommands : PendingCommandsBase<Backend> {
+  struct Command {
+    Entity entity;
+    int valueIndex;
+  };
+
+  std::vector<Command> commands;
+  std::vector<T> values;
+
+  bool empty() const override { return commands.empty(); }
+
+  void clear() override {
+    commands.clear();
+    values.clear();
+  }
+
+  void apply(Backend &registry,
+             const std::vector<PendingCommandsBase<Backend> *> &pending)
+      override {
+    struct Entry {
+      Entity entity;
+      const T *value;
+    };
+
+    std::vector<Entry> entries;
+    for (PendingCommandsBase<Backend> *base : pending) {
+      auto &buffer = *static_cast<PendingCommands *>(base);
+      for (const Command &command : buffer.commands) {
+        entries.push_back({command.entity, command.valueIndex == -1
+                                               ? nullptr
+                                               : &buffer.values[command.valueIndex]});
+      }
+    }
+
+    // Sorting by entity walks the sparse pages in order; being stable keeps
+    // each entity's commands in buffer and recording order, so the last one
+    // decides whether the entity ends up with the component.
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) {
+                       return a.entity < b.entity;
+                     });
+
+    std::vector<Entity> added;
+    std::vector<T> addedValues;
+    std::vector<Entity> removed;
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      if (i + 1 < entries.size() && entries[i + 1].entity == entries[i].entity) {
+        continue;
+      }
+      if (!registry.valid(entries[i].entity)) {
+        continue;
+      }
+      if (entries[i].value != nullptr) {
+        added.push_back(entries[i].entity);
+        addedValues.push_back(*entries[i].value);
+      } else {
+        removed.push_back(entries[i].entity);
+      }
+    }
+
+    registry.template remove<T>(removed.begin(), removed.end());
+    registry.template insert<T>(added.begin(), added.end(),
+                                static_cast<const T *>(addedValues.data()));
+  }
+};
+
+// Records structural changes for later playback. A buffer belongs to a
+// single thread; get one from CommandQueue::local().
+template <typename Backend> struct CommandBuffer {
+  explicit CommandBuffer(Backend &registry) : registry(&registry) {}
+
+  // The handle is usable in this buffer's commands right away and valid in
+  // the registry once the queue is played back.
+  Entity create() { return registry->reserve(); }
+
+  void destroy(Entity entity) { destroyed.push_back(entity); }
+
+  template <typename T> void addComponent(Entity entity, const T &component) {
+    auto &commands = pendingFor<T>();
+    commands.commands.push_back(
+        {entity, static_cast<int>(commands.values.size())});
+    commands.values.push_back(component);
+  }
+
+  template <typename T> void removeComponent(Entity entity) {
+    pendingFor<T>().commands.push_back({entity, -1});
+  }
+
+private:
+  template <typename> friend struct CommandQueue;
+
+  Backend *registry;
+  std::vector<Entity> destroyed;
+
+  // Indexed by componentTypeId<T>(), like the registry's storages.
+  std::vector<std::unique_ptr<PendingCommandsBase<Backend>>> pending;
+
+  template <typename T> PendingCommands<Backend, T> &pendingFor() {
+    int id = componentTypeId<T>();
+    if (id >= static_cast<int>(pending.size())) {
+      pending.resize(id + 1);
+    }
+    if (!pending[id]) {
+      pending[id] = std::make_unique<PendingCommands<Backend, T>>();
+    }
+    return *static_cast<PendingCommands<Backend, T> *>(pending[id].get());
+  }
+};
+
+// One CommandBuffer per thread of pool plus one for the thread that drives
+// it, so recording never locks. Threads outside the pool all share the
+// latter, so only one of them may record at a time.
+template <typename Backend> struct CommandQueue {
+  explicit CommandQueue(Backend &registry,
+                        ThreadPool &pool = defaultThreadPool())
+      : registry(&registry), pool(&pool) {
+    for (int i = 0; i < pool.concurrency(); i++) {
+      buffers.push_back(std::make_unique<CommandBuffer<Backend>>(registry));
+    }
+  }
+
+  CommandBuffer<Backend> &local() { return *buffers[pool->currentWorker() + 1]; }
+
+  // Sync point: no buffer may be recording. Reserved entities come alive
+  // first, then each component type gets one batched remove and one batched
+  // insert across all buffers, and destroys run last so they win over any
+  // add recorded for the same entity.
+  void playback() {
+    registry->flushReserved();
+
+    std::size_t typeCount = 0;
+    for (auto &buffer : buffers) {
+      typeCount = std::max(typeCount, buffer->pending.size());
+    }
+
+    std::vector<PendingCommandsBase<Backend> *> pending;
+    for (std::size_t id = 0; id < typeCount; id++) {
+      pending.clear();
+      for (auto &buffer : buffers) {
+        if (id < buffer->pending.size() && buffer->pending[id] &&
+            !buffer->pending[id]->empty()) {
+          pending.push_back(buffer->pending[id].get());
+        }
+      }
+      if (!pending.empty()) {
+        pending[0]->apply(*registry, pending);
+        for (PendingCommandsBase<Backend> *commands : pending) {
+          commands->clear();
+        }
+      }
+    }
+
+    std::vector<Entity> destroyed;
+    for (auto &buffer : buffers) {
+      destroyed.insert(destroyed.end(), buffer->destroyed.begin(),
+                       buffer->destroyed.end());
+      buffer->destroyed.clear();
+    }
+    std::sort(destroyed.begin(), destroyed.end());
+    destroyed.erase(std::unique(destroyed.begin(), destroyed.end()),
+                    destroyed.end());
+    for (Entity entity : destroyed) {
+      registry->destroy(entity);
+    }
+  }
+
+private:
+  Backend *registry;
+  ThreadPool *pool;
+  std::vector<std::unique_ptr<CommandBuffer<Backend>>> buffers;
+};
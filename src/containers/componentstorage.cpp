@@ -1,38 +1,508 @@
+#pragma once
+
+#include "alignedallocator.cpp"
+#include "pagepool.cpp"
+#include "signal.cpp"
+#include "soa.cpp"
 #include "sparseset.cpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+struct OwningGroupData;
+
+enum class SortMode {
+  // std::sort on an index permutation, then applied in place.
+  Full,
+  // Insertion sort by adjacent swaps: linear on already sorted data, so it
+  // can keep a storage ordered every frame while only a few elements move.
+  Incremental,
+};
+
+// Type-erased view of a storage, used by the registry and by groups for
+// operations that have to touch storages without knowing the component type.
+struct StorageBase {
+  // Set while an owning group controls the order of this storage.
+  OwningGroupData *group = nullptr;
+
+  // The registry's current tick, which changes are stamped with.
+  uint32_t tick = 1;
+
+  // Tick of the latest construct, update or destroy in this storage.
+  uint32_t version = 0;
+
+  virtual ~StorageBase() = default;
+  virtual void remove(Entity entity) = 0;
+  virtual void clear() = 0;
+  virtual int indexOf(Entity entity) const = 0;
+  virtual void swapElements(int a, int b) = 0;
+
+  // Bytes currently allocated by the storage, spare capacity included.
+  virtual std::size_t memoryUsage() const = 0;
+};
+
+// An owning group keeps the entities that have every one of its storages'
+// components in the first `size` slots of each storage, in the same order.
+struct OwningGroupData {
+  std::vector<StorageBase *> owned;
+  int size = 0;
+
+  void onAdded(Entity entity) {
+    for (StorageBase *storage : owned) {
+      int index = storage->indexOf(entity);
+      if (index == -1 || index < size) {
+        return;
+      }
+    }
+
+    for (StorageBase *storage : owned) {
+      storage->swapElements(storage->indexOf(entity), size);
+    }
+    size++;
+  }
+
+  void onRemoving(Entity entity) {
+    int index = owned.front()->indexOf(entity);
+    if (index == -1 || index >= size) {
+      return;
+    }
+
+    size--;
+    for (StorageBase *storage : owned) {
+      storage->swapElements(storage->indexOf(entity), size);
+    }
+  }
+};
+
+// Component array of an empty tag type: it only counts elements, and every
+// element is the same static T, so membership in the sparse set is all a tag
+// storage keeps. Mirrors the SoAArray interface the storage uses.
+template <typename T> struct TagArray {
+  std::size_t count = 0;
+
+  TagArray() = default;
+  template <typename Allocator> explicit TagArray(const Allocator &) {}
+
+  static T &instance() {
+    static T tag;
+    return tag;
+  }
+
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  std::size_t capacity() const { return 0; }
+
+  void reserve(std::size_t) {}
+  void shrink_to_fit() {}
+  void resize(std::size_t size) { count = size; }
+  void clear() { count = 0; }
+  void push_back(const T &) { count++; }
+  void pop_back() { count--; }
+  void append(const T *, std::size_t added) { count += added; }
+  void append(std::size_t added, const T &) { count += added; }
+  void swapElements(int, int) {}
+
+  T &operator[](int) { return instance(); }
+};
+
+template <typename T> struct TagSpan {
+  T &operator[](int) const { return TagArray<T>::instance(); }
+};
+
+template <typename T> TagSpan<T> componentSpan(TagArray<T> &) { return {}; }
+
+template <typename T, typename Allocator = PagePoolAllocator<T>>
+using ComponentArray = std::conditional_t<
+    std::is_empty_v<T>, TagArray<T>,
+    std::conditional_t<SoATraits<T>::enabled, SoAArray<T, Allocator>,
+                       std::vector<T, Allocator>>>;
+
+// components[i] belongs to sparseSet.dense[i]; both grow geometrically
+// together so the storage only pays for entities that hold a T. Every array
+// of the storage comes from Allocator, rebound as needed.
+template <typename T, typename Allocator = PagePoolAllocator<T>>
+struct ComponentStorage : StorageBase {
+  // True unless T is stored as SoA streams or as a tag.
+  static constexpr bool contiguous =
+      !SoATraits<T>::enabled && !std::is_empty_v<T>;
+
+  // T& normally, SoATraits<T>::Reference for SoA components, and a reference
+  // to a shared instance for tags.
+  using Reference =
+      decltype(std::declval<ComponentArray<T, Allocator> &>()[0]);
+  using Pointer = std::conditional_t<SoATraits<T>::enabled,
+                                     SoAPointer<T, Allocator>, T *>;
+
+  BasicSparseSet<RebindAllocator<Allocator, Entity>> sparseSet;
+  ComponentArray<T, Allocator> components;
+
+  // Published after a T is added to an entity, after an existing one is
+  // overwritten or patched, and before one is removed.
+  Signal onConstruct;
+  Signal onUpdate;
+  Signal onDestroy;
+
+  // Tick of each component's latest construct or update, parallel to
+  // components. Only kept once trackChanges() was called.
+  std::vector<uint32_t, RebindAllocator<Allocator, uint32_t>> changeTicks;
+  std::atomic<bool> tracking{false};
 
-template <typename T> struct ComponentStorage {
-  SparseSet sparseSet;
-  T components[50];
+  explicit ComponentStorage(const Allocator &allocator = Allocator())
+      : sparseSet(allocator), components(allocator), changeTicks(allocator) {}
 
-  void addComponent(int entityID, const T &component) {
-    sparseSet.add(entityID);
-    int ent_index = sparseSet.sparse[entityID];
-    components[ent_index] = component;
+  // Safe to call from systems that only read T while others do the same.
+  void trackChanges() {
+    if (tracking.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(trackingMutex);
+    if (!tracking.load(std::memory_order_relaxed)) {
+      changeTicks.assign(size(), tick);
+      tracking.store(true, std::memory_order_release);
+    }
+  }
+
+  // Untracked storages report every component as changed.
+  bool changedSince(int index, uint32_t since) const {
+    return !tracking || changeTicks[index] >= since;
   }
 
-  void removeComponent(int entityID) {
-    int remove_index = sparseSet.sparse[entityID];
-    int last_valid_index = sparseSet.n - 1;
+  int size() const { return sparseSet.size(); }
+
+  void reserve(int capacity) {
+    sparseSet.reserve(capacity);
+    components.reserve(capacity);
+  }
+
+  // Gives spare capacity and unused sparse pages back to the allocator.
+  void shrinkToFit() {
+    sparseSet.shrinkToFit();
+    components.shrink_to_fit();
+    changeTicks.shrink_to_fit();
+  }
+
+  std::size_t memoryUsage() const override {
+    std::size_t bytes = sparseSet.memoryUsage() + capacityBytes(changeTicks);
+    if constexpr (SoATraits<T>::enabled) {
+      for (const auto &stream : components.streams) {
+        bytes += capacityBytes(stream);
+      }
+    } else if constexpr (!std::is_empty_v<T>) {
+      bytes += capacityBytes(components);
+    }
+    return bytes;
+  }
+
+  void addComponent(Entity entityID, const T &component) {
+    int index = sparseSet.add(entityID);
+    if (index != static_cast<int>(components.size())) {
+      components[index] = component;
+      updated(index);
+      return;
+    }
+
+    components.push_back(component);
+    constructed();
+    if (group) {
+      group->onAdded(entityID);
+    }
+    if (!onConstruct.empty()) {
+      onConstruct.publish(entityID);
+    }
+  }
+
+  // Overwrites the T of an entity that has one; does nothing otherwise.
+  void replace(Entity entityID, const T &component) {
+    int index = sparseSet.contains(entityID);
+    if (index != -1) {
+      components[index] = component;
+      updated(index);
+    }
+  }
+
+  // Calls func(Reference) on the entity's T and records it as updated. Like
+  // every other mutation of the storage, not safe from parallelEach.
+  template <typename Func> void patch(Entity entityID, Func func) {
+    int index = sparseSet.contains(entityID);
+    if (index != -1) {
+      Reference component = components[index];
+      func(component);
+      updated(index);
+    }
+  }
 
+  // Records the components in dense slots [begin, end) as updated after a
+  // bulk write straight to the arrays, such as a stream kernel's.
+  void markUpdated(int begin, int end) {
+    if (begin >= end) {
+      return;
+    }
+    version = tick;
+    if (tracking) {
+      std::fill(changeTicks.begin() + begin, changeTicks.begin() + end, tick);
+    }
+    if (!onUpdate.empty()) {
+      for (int index = begin; index < end; index++) {
+        onUpdate.publish(sparseSet.dense[index]);
+      }
+    }
+  }
+
+  void removeComponent(Entity entityID) {
+    int remove_index = sparseSet.contains(entityID);
+    if (remove_index == -1) {
+      return;
+    }
+
+    if (!onDestroy.empty()) {
+      onDestroy.publish(entityID);
+    }
+    version = tick;
+
+    if (group) {
+      group->onRemoving(entityID);
+      remove_index = sparseSet.contains(entityID);
+    }
+
+    int last_valid_index = sparseSet.size() - 1;
     if (remove_index != last_valid_index) {
       components[remove_index] = std::move(components[last_valid_index]);
-
-      int last_entity_id = sparseSet.dense[last_valid_index];
-      sparseSet.sparse[last_entity_id] = remove_index;
+    }
+    components.pop_back();
+    if (tracking) {
+      changeTicks[remove_index] = changeTicks[last_valid_index];
+      changeTicks.pop_back();
     }
     sparseSet.remove(entityID);
   }
 
-  T *getComponent(int entityID) {
-    int index = sparseSet.sparse[entityID];
+  // Bulk addComponent: values[i] goes to the i-th entity of [first, last).
+  // When none of the entities has a T yet, the components are appended as one
+  // block, which is a memmove for trivially copyable T.
+  template <typename It> void insert(It first, It last, const T *values) {
+    insertWith(first, last, [values](int i) -> const T & { return values[i]; },
+               [this, values](int count) {
+                 if constexpr (contiguous) {
+                   components.insert(components.end(), values, values + count);
+                 } else {
+                   components.append(values, count);
+                 }
+               });
+  }
 
-    int containsCheck = sparseSet.contains(entityID);
+  // Bulk addComponent giving every entity in [first, last) the same value.
+  template <typename It> void insert(It first, It last, const T &value) {
+    insertWith(first, last, [&value](int) -> const T & { return value; },
+               [this, &value](int count) {
+                 if constexpr (contiguous) {
+                   components.insert(components.end(), count, value);
+                 } else {
+                   components.append(count, value);
+                 }
+               });
+  }
 
-    if (containsCheck == -1) {
-      return nullptr;
+  template <typename It> void remove(It first, It last) {
+    for (; first != last; ++first) {
+      removeComponent(*first);
     }
+  }
 
-    return &components[index];
+  void clear() override {
+    if (!onDestroy.empty()) {
+      for (Entity entity : sparseSet.dense) {
+        onDestroy.publish(entity);
+      }
+    }
+    if (size() > 0) {
+      version = tick;
+    }
+    changeTicks.clear();
+    if (group) {
+      group->size = 0;
+    }
+    sparseSet.clear();
+    components.clear();
+  }
+
+  Pointer getComponent(Entity entityID) {
+    int index = sparseSet.contains(entityID);
+
+    if (index == -1) {
+      return Pointer{};
+    }
+
+    if constexpr (SoATraits<T>::enabled) {
+      return Pointer{&components, index};
+    } else {
+      return &components[index];
+    }
+  }
+
+  void remove(Entity entity) override { removeComponent(entity); }
+
+  int indexOf(Entity entity) const override {
+    return sparseSet.contains(entity);
+  }
+
+  void swapElements(int a, int b) override {
+    if (a == b) {
+      return;
+    }
+    if constexpr (contiguous) {
+      std::swap(components[a], components[b]);
+    } else {
+      components.swapElements(a, b);
+    }
+    if (tracking) {
+      std::swap(changeTicks[a], changeTicks[b]);
+    }
+    sparseSet.swap(a, b);
+  }
+
+  // Reorders the storage by compare, called with two components (as
+  // References for SoA components) if it accepts them, else two entities. Entities, components,
+  // change ticks and sparse indices are permuted together. A storage owned
+  // by a group is ordered by the group and cannot be sorted.
+  template <typename Compare>
+  void sort(Compare compare, SortMode mode = SortMode::Full) {
+    assert(group == nullptr);
+    auto less = [this, &compare](int a, int b) {
+      if constexpr (std::is_invocable_v<Compare &, Reference, Reference>) {
+        return compare(components[a], components[b]);
+      } else {
+        return compare(sparseSet.dense[a], sparseSet.dense[b]);
+      }
+    };
+
+    if (mode == SortMode::Incremental) {
+      for (int i = 1; i < size(); i++) {
+        for (int j = i; j > 0 && less(j, j - 1); j--) {
+          swapElements(j, j - 1);
+        }
+      }
+      return;
+    }
+
+    std::vector<int> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), less);
+    permute(order);
+  }
+
+  // Puts the entities other also holds first, in other's order, followed by
+  // the rest in their current order.
+  template <typename U, typename OtherAllocator>
+  void sortAs(const ComponentStorage<U, OtherAllocator> &other) {
+    assert(group == nullptr);
+    std::vector<int> order;
+    order.reserve(size());
+    for (Entity entity : other.sparseSet.dense) {
+      int index = sparseSet.contains(entity);
+      if (index != -1) {
+        order.push_back(index);
+      }
+    }
+    if (static_cast<int>(order.size()) != size()) {
+      for (int index = 0; index < size(); index++) {
+        if (other.sparseSet.contains(sparseSet.dense[index]) == -1) {
+          order.push_back(index);
+        }
+      }
+    }
+    permute(order);
+  }
+
+private:
+  // Several readers may call changed<T> on the same view in one frame.
+  std::mutex trackingMutex;
+
+  // Moves the element at order[i] to slot i by following each cycle of the
+  // permutation with swaps, so nothing is copied out of line.
+  void permute(std::vector<int> &order) {
+    for (int i = 0; i < size(); i++) {
+      int current = i;
+      int next = order[current];
+      while (next != i) {
+        swapElements(current, next);
+        order[current] = current;
+        current = next;
+        next = order[current];
+      }
+      order[current] = current;
+    }
+  }
+
+  template <typename It, typename ValueAt, typename AppendAll>
+  void insertWith(It first, It last, ValueAt valueAt, AppendAll appendAll) {
+    int start = size();
+    int count = static_cast<int>(std::distance(first, last));
+    components.reserve(start + count);
+
+    if (sparseSet.insert(first, last)) {
+      appendAll(count);
+      if (tracking) {
+        changeTicks.resize(size(), tick);
+      }
+    } else {
+      // Dense order is first-appearance order, so an entity whose index is
+      // past the end of components is always the next one to append.
+      int i = 0;
+      for (It entity = first; entity != last; ++entity, ++i) {
+        int index = sparseSet.contains(*entity);
+        if (index < static_cast<int>(components.size())) {
+          components[index] = valueAt(i);
+          updated(index);
+        } else {
+          components.push_back(valueAt(i));
+          constructed();
+        }
+      }
+    }
+
+    if (size() == start) {
+      return;
+    }
+    version = tick;
+
+    // A group swap only moves the new entity in front of start, so every
+    // later slot still holds the next new entity.
+    if (group || !onConstruct.empty()) {
+      for (int index = start; index < size(); index++) {
+        Entity entity = sparseSet.dense[index];
+        if (group) {
+          group->onAdded(entity);
+        }
+        if (!onConstruct.empty()) {
+          onConstruct.publish(entity);
+        }
+      }
+    }
+  }
+
+  // Stamps the component just appended at the end of components.
+  void constructed() {
+    version = tick;
+    if (tracking) {
+      changeTicks.push_back(tick);
+    }
+  }
+
+  void updated(int index) {
+    version = tick;
+    if (tracking) {
+      changeTicks[index] = tick;
+    }
+    if (!onUpdate.empty()) {
+      onUpdate.publish(sparseSet.dense[index]);
+    }
   }
 };
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <atomic>
+
+// Every component type gets a small dense ID the first time it is used, which
+// the registry uses as a direct index into its storage table.
+inline int nextComponentTypeId() {
+  static std::atomic<int> counter{0};
+  return counter++;
+}
+
+template <typename T> int componentTypeId() {
+  static const int id = nextComponentTypeId();
+  return id;
+}
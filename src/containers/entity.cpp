@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// An entity handle packs a 24-bit index into the registry's entity array with
+// an 8-bit generation that is bumped every time the index is recycled, so a
+// handle to a destroyed entity never matches whoever reuses its slot.
+using Entity = uint32_t;
+
+const uint32_t ENTITY_INDEX_BITS = 24;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const uint32_t ENTITY_GENERATION_MASK = 0xFF;
+
+// The all-ones index is reserved as the end-of-free-list marker.
+const Entity NULL_ENTITY = 0xFFFFFFFF;
+
+// Indices 0 .. ENTITY_INDEX_MASK - 1 are usable; creating more throws
+// std::length_error rather than handing out handles that alias.
+const uint32_t MAX_ENTITIES = ENTITY_INDEX_MASK;
+
+inline uint32_t entityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+
+inline uint32_t entityGeneration(Entity entity) {
+  return (entity >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK;
+}
+
+inline Entity makeEntity(uint32_t index, uint32_t generation) {
+  return (index & ENTITY_INDEX_MASK) |
+         ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS);
+}
+
+// Hands out entity handles and recycles their indices. Alive slots hold their
+// own handle; free slots form an implicit linked list headed by freeList,
+// storing the next free index in their index bits and the generation the
+// slot will be handed out with in their generation bits, so recycling an
+// index never allocates.
+struct EntityPool {
+  std::vector<Entity> entities;
+  uint32_t freeList = ENTITY_INDEX_MASK;
+
+  // Handles given out by reserve() that are not in entities yet.
+  std::atomic<uint32_t> reservedCount{0};
+
+  Entity create() {
+    if (freeList == ENTITY_INDEX_MASK) {
+      checkCapacity(1);
+      Entity entity = makeEntity(static_cast<uint32_t>(entities.size()), 0);
+      entities.push_back(entity);
+      return entity;
+    }
+
+    uint32_t index = freeList;
+    Entity slot = entities[index];
+    freeList = entityIndex(slot);
+
+    Entity entity = makeEntity(index, entityGeneration(slot));
+    entities[index] = entity;
+    return entity;
+  }
+
+  // Hands out count entities with contiguous indices taken from the end of
+  // the entity array, leaving the free list untouched.
+  std::vector<Entity> create(int count) {
+    checkCapacity(count);
+    std::vector<Entity> created;
+    created.reserve(count);
+    entities.reserve(entities.size() + count);
+
+    for (int i = 0; i < count; i++) {
+      Entity entity = makeEntity(static_cast<uint32_t>(entities.size()), 0);
+      entities.push_back(entity);
+      created.push_back(entity);
+    }
+    return created;
+  }
+
+  // Hands out a fresh index past the end of the entity array without
+  // touching it, so any thread can call it while the pool is otherwise left
+  // alone. The handle becomes valid at the next flushReserved().
+  Entity reserve() {
+    uint32_t index =
+        static_cast<uint32_t>(entities.size()) + reservedCount.fetch_add(1);
+    if (index >= MAX_ENTITIES) {
+      throw std::length_error("entity index space exhausted");
+    }
+    return makeEntity(index, 0);
+  }
+
+  // Makes every reserved handle alive. Returns the index of the first one;
+  // they are contiguous up to the end of the entity array.
+  uint32_t flushReserved() {
+    uint32_t first = static_cast<uint32_t>(entities.size());
+    uint32_t count = reservedCount.exchange(0);
+    for (uint32_t i = 0; i < count; i++) {
+      entities.push_back(makeEntity(first + i, 0));
+    }
+    return first;
+  }
+
+  void release(Entity entity) {
+    uint32_t index = entityIndex(entity);
+    entities[index] = makeEntity(freeList, entityGeneration(entity) + 1);
+    freeList = index;
+  }
+
+  // Releases every alive entity, so handles to them all go stale.
+  void releaseAll() {
+    for (uint32_t index = 0; index < entities.size(); index++) {
+      if (entityIndex(entities[index]) == index) {
+        release(entities[index]);
+      }
+    }
+  }
+
+  bool valid(Entity entity) const {
+    uint32_t index = entityIndex(entity);
+    return index < entities.size() && entities[index] == entity;
+  }
+
+private:
+  // Throws unless count more indices fit past the end of the array and any
+  // outstanding reservations.
+  void checkCapacity(uint64_t count) const {
+    uint64_t used = entities.size() + reservedCount.load();
+    if (used + count > MAX_ENTITIES) {
+      throw std::length_error("entity index space exhausted");
+    }
+  }
+};
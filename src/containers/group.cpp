@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../jobs/threadpool.cpp"
+#include "alignedallocator.cpp"
+#include "componentstorage.cpp"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Iterates the entities of an owning group. The group's storages keep those
+// entities packed at the front in the same order, so walking it is a linear
+// pass over parallel arrays with no sparse lookups or membership checks.
+template <typename Allocator, typename... Owned> struct BasicGroup {
+  template <typename T>
+  using Storage = ComponentStorage<T, RebindAllocator<Allocator, T>>;
+
+  std::tuple<Storage<Owned> *...> storages;
+  OwningGroupData *data;
+
+  int size() const { return data->size; }
+
+  // func is called as func(entity, Owned&...) or func(Owned&...), with SoA
+  // components passed as their Reference proxy.
+  template <typename Func> void each(Func func) {
+    eachInRange(func, 0, data->size, std::index_sequence_for<Owned...>{});
+  }
+
+  // Like each(), but runs cache-line-aligned chunks concurrently on pool.
+  // Every owned array is in the same order, so no chunk shares a cache line
+  // with another in any of them.
+  template <typename Func>
+  void parallelEach(Func func, ThreadPool &pool = defaultThreadPool()) {
+    parallelFor(pool, data->size, CACHE_LINE_SIZE,
+                [this, &func](int begin, int end) {
+                  eachInRange(func, begin, end,
+                              std::index_sequence_for<Owned...>{});
+                });
+  }
+
+private:
+  template <typename Func, std::size_t... I>
+  void eachInRange(Func &func, int begin, int end, std::index_sequence<I...>) {
+    const Entity *entities = std::get<0>(storages)->sparseSet.dense.data();
+    auto components =
+        std::make_tuple(componentSpan(std::get<I>(storages)->components)...);
+
+    for (int i = begin; i < end; i++) {
+      if constexpr (std::is_invocable_v<
+                        Func &, Entity,
+                        typename Storage<Owned>::Reference...>) {
+        func(entities[i], std::get<I>(components)[i]...);
+      } else {
+        func(std::get<I>(components)[i]...);
+      }
+    }
+  }
+};
+
+template <typename... Owned>
+using Group = BasicGroup<PagePoolAllocator<char>, Owned...>;
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "alignedallocator.cpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+const int PAGE_POOL_CLASS_COUNT = 32;
+const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Hands out power-of-two pages from one cache line up, each aligned to at
+// least CACHE_LINE_SIZE. Freed pages go onto a free list per size that every
+// storage shares, so the block a vector leaves behind when it grows or
+// shrinks is reused by the next storage of that size instead of going back
+// to the heap. Pages of HUGE_PAGE_SIZE and up are aligned to it, and with
+// hugePages set they are advised as transparent huge pages on Linux.
+struct PagePool {
+  std::atomic<bool> hugePages{false};
+
+  PagePool() = default;
+  PagePool(const PagePool &) = delete;
+  PagePool &operator=(const PagePool &) = delete;
+
+  ~PagePool() { trim(); }
+
+  void *allocate(std::size_t bytes) {
+    int sizeClass = classOf(bytes);
+    std::size_t size = pageSize(sizeClass);
+    {
+      SizeClass &list = classes[sizeClass];
+      std::lock_guard<std::mutex> lock(list.mutex);
+      if (list.head != nullptr) {
+        FreePage *page = list.head;
+        list.head = page->next;
+        freeBytes.fetch_sub(size, std::memory_order_relaxed);
+        return page;
+      }
+    }
+
+    void *page = ::operator new(size, std::align_val_t(alignmentOf(size)));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (size >= HUGE_PAGE_SIZE && hugePages.load(std::memory_order_relaxed)) {
+      madvise(page, size, MADV_HUGEPAGE);
+    }
+#endif
+    reservedBytes.fetch_add(size, std::memory_order_relaxed);
+    return page;
+  }
+
+  void deallocate(void *pointer, std::size_t bytes) {
+    int sizeClass = classOf(bytes);
+    SizeClass &list = classes[sizeClass];
+    std::lock_guard<std::mutex> lock(list.mutex);
+    list.head = new (pointer) FreePage{list.head};
+    freeBytes.fetch_add(pageSize(sizeClass), std::memory_order_relaxed);
+  }
+
+  // Hands every free page back to the heap.
+  void trim() {
+    for (int sizeClass = 0; sizeClass < PAGE_POOL_CLASS_COUNT; sizeClass++) {
+      std::size_t size = pageSize(sizeClass);
+      SizeClass &list = classes[sizeClass];
+      std::lock_guard<std::mutex> lock(list.mutex);
+      while (list.head != nullptr) {
+        FreePage *page = list.head;
+        list.head = page->next;
+        ::operator delete(page, std::align_val_t(alignmentOf(size)));
+        freeBytes.fetch_sub(size, std::memory_order_relaxed);
+        reservedBytes.fetch_sub(size, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Bytes a request for bytes actually takes: its size class's page.
+  static std::size_t pageSizeFor(std::size_t bytes) {
+    return pageSize(classOf(bytes));
+  }
+
+  // Bytes taken from the heap, including the ones sitting on free lists.
+  std::size_t reserved() const {
+    return reservedBytes.load(std::memory_order_relaxed);
+  }
+
+  std::size_t free() const { return freeBytes.load(std::memory_order_relaxed); }
+
+private:
+  struct FreePage {
+    FreePage *next;
+  };
+
+  struct SizeClass {
+    std::mutex mutex;
+    FreePage *head = nullptr;
+  };
+
+  SizeClass classes[PAGE_POOL_CLASS_COUNT];
+  std::atomic<std::size_t> reservedBytes{0};
+  std::atomic<std::size_t> freeBytes{0};
+
+  static int classOf(std::size_t bytes) {
+    int sizeClass = 0;
+    while (pageSize(sizeClass) < bytes) {
+      sizeClass++;
+    }
+    return sizeClass;
+  }
+
+  static std::size_t pageSize(int sizeClass) {
+    return CACHE_LINE_SIZE << sizeClass;
+  }
+
+  static std::size_t alignmentOf(std::size_t size) {
+    return size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+  }
+};
+
+// Never destroyed, so storages that outlive static destruction order can
+// still hand their pages back.
+inline PagePool &defaultPagePool() {
+  static PagePool *pool = new PagePool();
+  return *pool;
+}
+
+// Default allocator of every storage: draws from a PagePool, the shared one
+// unless another is given.
+template <typename T> struct PagePoolAllocator {
+  using value_type = T;
+
+  static_assert(alignof(T) <= CACHE_LINE_SIZE,
+                "pages are only aligned to a cache line");
+
+  PagePool *pool = &defaultPagePool();
+
+  PagePoolAllocator() = default;
+  explicit PagePoolAllocator(PagePool &pool) : pool(&pool) {}
+  template <typename U>
+  PagePoolAllocator(const PagePoolAllocator<U> &other) : pool(other.pool) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(pool->allocate(count * sizeof(T)));
+  }
+
+  void deallocate(T *pointer, std::size_t count) {
+    pool->deallocate(pointer, count * sizeof(T));
+  }
+
+  std::size_t allocationSize(std::size_t count) const {
+    return PagePool::pageSizeFor(count * sizeof(T));
+  }
+
+  template <typename U> bool operator==(const PagePoolAllocator<U> &other) const {
+    return pool == other.pool;
+  }
+  template <typename U> bool operator!=(const PagePoolAllocator<U> &other) const {
+    return pool != other.pool;
+  }
+};
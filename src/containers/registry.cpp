@@ -1,37 +1,250 @@
+#pragma once
+
 #include "componentstorage.cpp"
+#include "componenttype.cpp"
+#include "entity.cpp"
+#include "group.cpp"
+#include "view.cpp"
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <typeindex>
-#include <unordered_map>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-struct Registry {
+// Allocator is rebound for every array of every storage; the default draws
+// them all from the shared PagePool.
+template <typename Allocator = PagePoolAllocator<char>> struct BasicRegistry {
 public:
-  template <typename T> void addComponent(int entityID, const T &component) {
+  template <typename T>
+  using Storage = ComponentStorage<T, RebindAllocator<Allocator, T>>;
+
+  explicit BasicRegistry(const Allocator &allocator = Allocator())
+      : allocator(allocator) {}
+  Entity create() {
+    flushReserved();
+    return entityPool.create();
+  }
+
+  std::vector<Entity> create(int count) {
+    flushReserved();
+    return entityPool.create(count);
+  }
+
+  // Thread-safe handle for an entity that comes alive at the next
+  // flushReserved() or create(). Must not race with create or destroy.
+  Entity reserve() { return entityPool.reserve(); }
+
+  void flushReserved() { entityPool.flushReserved(); }
+
+  void destroy(Entity entity) {
+    if (!valid(entity)) {
+      return;
+    }
+
+    for (auto &storage : componentStorages) {
+      if (storage) {
+        storage->remove(entity);
+      }
+    }
+    entityPool.release(entity);
+  }
+
+  bool valid(Entity entity) const { return entityPool.valid(entity); }
+
+  template <typename T> void addComponent(Entity entityID, const T &component) {
     auto &storage = getStorage<T>();
     storage.addComponent(entityID, component);
   }
 
-  template <typename T> void removeComponent(int entityID) {
+  template <typename T> void removeComponent(Entity entityID) {
     auto &storage = getStorage<T>();
     storage.removeComponent(entityID);
   }
 
-  template <typename T> T *getComponent(int entityID) {
+  // Writes through replace or patch are what change tracking and onUpdate
+  // see; writing through getComponent or a view goes unnoticed.
+  template <typename T> void replace(Entity entityID, const T &component) {
+    getStorage<T>().replace(entityID, component);
+  }
+
+  template <typename T, typename Func> void patch(Entity entityID, Func func) {
+    getStorage<T>().patch(entityID, std::move(func));
+  }
+
+  uint32_t tick() const { return currentTick; }
+
+  // While locked, creating a storage asserts. The scheduler locks them
+  // while systems run in parallel, since growing componentStorages would
+  // race with every other system's lookups.
+  void lockStorages(bool locked) { storagesLocked = locked; }
+
+  // Starts the next tick; changes are stamped with the tick they happen in.
+  uint32_t advanceTick() {
+    currentTick++;
+    for (auto &storage : componentStorages) {
+      if (storage) {
+        storage->tick = currentTick;
+      }
+    }
+    return currentTick;
+  }
+
+  // Bulk addComponent: components[i] goes to the i-th entity of
+  // [first, last), with a single storage lookup and reservation.
+  template <typename T, typename It>
+  void insert(It first, It last, const T *components) {
+    getStorage<T>().insert(first, last, components);
+  }
+
+  template <typename T, typename It,
+            typename = std::enable_if_t<!std::is_pointer_v<T>>>
+  void insert(It first, It last, const T &component) {
+    getStorage<T>().insert(first, last, component);
+  }
+
+  template <typename T, typename It> void remove(It first, It last) {
+    getStorage<T>().remove(first, last);
+  }
+
+  template <typename T, typename Compare>
+  void sort(Compare compare, SortMode mode = SortMode::Full) {
+    getStorage<T>().sort(std::move(compare), mode);
+  }
+
+  // Orders T's storage like U's, so views over both walk them in step.
+  template <typename T, typename U> void sortAs() {
+    getStorage<T>().sortAs(getStorage<U>());
+  }
+
+  template <typename T> void clear() { getStorage<T>().clear(); }
+
+  // Destroys every entity and empties every storage.
+  void clear() {
+    for (auto &storage : componentStorages) {
+      if (storage) {
+        storage->clear();
+      }
+    }
+    entityPool.releaseAll();
+  }
+
+  // A T* for regular components, an SoAPointer<T> for SoA ones. For empty
+  // tags it only tells whether the entity has one.
+  template <typename T>
+  typename Storage<T>::Pointer getComponent(Entity entityID) {
     auto &storage = getStorage<T>();
     return storage.getComponent(entityID);
   }
 
+  // The handle table, for code that saves and restores it wholesale.
+  EntityPool &pool() { return entityPool; }
+
+  // Direct access to the storage of T, for code that works on whole arrays.
+  template <typename T> Storage<T> &storage() {
+    return getStorage<T>();
+  }
+
+  // Bytes allocated by T's storage, spare capacity included.
+  template <typename T> std::size_t memoryUsage() {
+    return getStorage<T>().memoryUsage();
+  }
+
+  // Bytes allocated by all storages.
+  std::size_t memoryUsage() const {
+    std::size_t bytes = 0;
+    for (auto &storage : componentStorages) {
+      if (storage) {
+        bytes += storage->memoryUsage();
+      }
+    }
+    return bytes;
+  }
+
+  template <typename... Get, typename... Exclude>
+  BasicView<Allocator, ExcludeList<Exclude...>, Get...>
+  view(ExcludeList<Exclude...> = ExcludeList<Exclude...>{}) {
+    return BasicView<Allocator, ExcludeList<Exclude...>, Get...>(
+        std::make_tuple(&getStorage<Get>()...),
+        std::make_tuple(&getStorage<Exclude>()...));
+  }
+
+  // Returns the group owning exactly Owned..., creating it on first use. A
+  // storage can be owned by a single group; asking for a group that overlaps
+  // an existing one with a different component set is an error.
+  template <typename... Owned> BasicGroup<Allocator, Owned...> group() {
+    static_assert(sizeof...(Owned) > 1, "a group needs at least two components");
+
+    BasicGroup<Allocator, Owned...> result{
+        std::make_tuple(&getStorage<Owned>()...), nullptr};
+    StorageBase *owned[] = {&getStorage<Owned>()...};
+
+    result.data = owned[0]->group;
+    if (result.data != nullptr) {
+      assert(result.data->owned.size() == sizeof...(Owned));
+      for (StorageBase *storage : owned) {
+        assert(storage->group == result.data);
+        (void)storage;
+      }
+      return result;
+    }
+
+    for (StorageBase *storage : owned) {
+      assert(storage->group == nullptr);
+      (void)storage;
+    }
+
+    groups.push_back(std::make_unique<OwningGroupData>());
+    result.data = groups.back().get();
+    result.data->owned.assign(std::begin(owned), std::end(owned));
+    for (StorageBase *storage : owned) {
+      storage->group = result.data;
+    }
+
+    // Pull in the entities that already have every owned component.
+    auto &first = *std::get<0>(result.storages);
+    for (int i = 0; i < first.size(); i++) {
+      result.data->onAdded(first.sparseSet.dense[i]);
+    }
+    return result;
+  }
+
 private:
-  std::unordered_map<std::type_index, std::shared_ptr<void>> componentStorages;
+  Allocator allocator;
+
+  // Indexed by componentTypeId<T>(); slots for types this registry has not
+  // seen yet are null.
+  std::vector<std::unique_ptr<StorageBase>> componentStorages;
+
+  std::vector<std::unique_ptr<OwningGroupData>> groups;
+
+  EntityPool entityPool;
 
-  template <typename T> ComponentStorage<T> &getStorage() {
-    std::type_index type_index = std::type_index(typeid(T));
+  uint32_t currentTick = 1;
+  bool storagesLocked = false;
 
-    if (componentStorages.find(type_index) == componentStorages.end()) {
-      componentStorages[type_index] = std::make_shared<ComponentStorage<T>>();
+  template <typename T> Storage<T> &getStorage() {
+    int id = componentTypeId<T>();
+    assert((!storagesLocked ||
+            (id < static_cast<int>(componentStorages.size()) &&
+             componentStorages[id])) &&
+           "a system used a component missing from its Read/Write list");
+
+    if (id >= static_cast<int>(componentStorages.size())) {
+      componentStorages.resize(id + 1);
+    }
+
+    std::unique_ptr<StorageBase> &storage = componentStorages[id];
+    if (!storage) {
+      storage = std::make_unique<Storage<T>>(
+          RebindAllocator<Allocator, T>(allocator));
+      storage->tick = currentTick;
     }
 
-    return *std::static_pointer_cast<ComponentStorage<T>>(
-        componentStorages[type_index]);
+    return *static_cast<Storage<T> *>(storage.get());
   }
 };
+
+using Registry = BasicRegistry<>;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "entity.cpp"
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+// A list of listeners called with an entity. Storages check empty() before
+// publishing, so a signal nobody connected to costs a branch. Listeners must
+// not add or remove components of the storage that is publishing.
+struct Signal {
+  // Returns an ID to pass to disconnect.
+  int connect(std::function<void(Entity)> listener) {
+    listeners.emplace_back(nextId, std::move(listener));
+    return nextId++;
+  }
+
+  void disconnect(int id) {
+    for (auto it = listeners.begin(); it != listeners.end(); ++it) {
+      if (it->first == id) {
+        listeners.erase(it);
+        return;
+      }
+    }
+  }
+
+  bool empty() const { return listeners.empty(); }
+
+  void publish(Entity entity) const {
+    for (const auto &listener : listeners) {
+      listener.second(entity);
+    }
+  }
+
+private:
+  std::vector<std::pair<int, std::function<void(Entity)>>> listeners;
+  int nextId = 0;
+};
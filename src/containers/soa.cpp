@@ -0,0 +1,166 @@
+#pragma once
+
+#include "alignedallocator.cpp"
+#include "pagepool.cpp"
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Opt-in structure-of-arrays layout. A component opts in by specialising
+// SoATraits with enabled = true, the Scalar type and streamCount of its
+// fields, and a Reference aggregate of Scalar& (one per stream, in stream
+// order) that converts to and assigns from the component. Its storage then
+// keeps one aligned stream per field and hands out References instead of T&.
+template <typename T> struct SoATraits {
+  static constexpr bool enabled = false;
+};
+
+template <typename T> struct SoASpan {
+  using Traits = SoATraits<T>;
+  using Scalar = typename Traits::Scalar;
+  using Reference = typename Traits::Reference;
+
+  std::array<Scalar *, Traits::streamCount> streams;
+
+  Reference operator[](int index) const {
+    return at(index, std::make_index_sequence<Traits::streamCount>{});
+  }
+
+private:
+  template <std::size_t... S>
+  Reference at(int index, std::index_sequence<S...>) const {
+    return Reference{streams[S][index]...};
+  }
+};
+
+// Same element interface as the std::vector a regular storage uses, except
+// that operator[] returns a Reference proxy by value. Allocator is rebound to
+// Scalar for every stream.
+template <typename T, typename Allocator = PagePoolAllocator<T>>
+struct SoAArray {
+  using Traits = SoATraits<T>;
+  using Scalar = typename Traits::Scalar;
+  using Reference = typename Traits::Reference;
+  static constexpr int streamCount = Traits::streamCount;
+  using Stream = std::vector<Scalar, RebindAllocator<Allocator, Scalar>>;
+
+  std::array<Stream, streamCount> streams;
+
+  explicit SoAArray(const Allocator &allocator = Allocator())
+      : SoAArray(allocator, std::make_index_sequence<streamCount>{}) {}
+
+  std::size_t size() const { return streams[0].size(); }
+
+  std::size_t capacity() const { return streams[0].capacity(); }
+
+  void shrink_to_fit() {
+    for (auto &stream : streams) {
+      stream.shrink_to_fit();
+    }
+  }
+  bool empty() const { return streams[0].empty(); }
+
+  void reserve(std::size_t capacity) {
+    for (auto &stream : streams) {
+      stream.reserve(capacity);
+    }
+  }
+
+  void resize(std::size_t count) {
+    for (auto &stream : streams) {
+      stream.resize(count);
+    }
+  }
+
+  void clear() {
+    for (auto &stream : streams) {
+      stream.clear();
+    }
+  }
+
+  void push_back(const T &value) {
+    for (auto &stream : streams) {
+      stream.emplace_back();
+    }
+    (*this)[static_cast<int>(size()) - 1] = value;
+  }
+
+  void pop_back() {
+    for (auto &stream : streams) {
+      stream.pop_back();
+    }
+  }
+
+  // Bulk push_back of count values, transposed into the streams.
+  void append(const T *values, std::size_t count) {
+    std::size_t start = size();
+    resize(start + count);
+    SoASpan<T> destination = span();
+    for (std::size_t i = 0; i < count; i++) {
+      destination[static_cast<int>(start + i)] = values[i];
+    }
+  }
+
+  void append(std::size_t count, const T &value) {
+    std::size_t start = size();
+    resize(start + count);
+    SoASpan<T> destination = span();
+    for (std::size_t i = 0; i < count; i++) {
+      destination[static_cast<int>(start + i)] = value;
+    }
+  }
+
+  Scalar *stream(int index) { return streams[index].data(); }
+
+  SoASpan<T> span() {
+    SoASpan<T> result;
+    for (int i = 0; i < streamCount; i++) {
+      result.streams[i] = streams[i].data();
+    }
+    return result;
+  }
+
+  Reference operator[](int index) { return span()[index]; }
+
+  void swapElements(int a, int b) {
+    for (auto &stream : streams) {
+      std::swap(stream[a], stream[b]);
+    }
+  }
+
+private:
+  template <std::size_t... S>
+  SoAArray(const Allocator &allocator, std::index_sequence<S...>)
+      : streams{((void)S, Stream(allocator))...} {}
+};
+
+// What getComponent returns for SoA components: null-checkable like a T*,
+// with -> and * going through a Reference.
+template <typename T, typename Allocator = PagePoolAllocator<T>>
+struct SoAPointer {
+  using Reference = typename SoATraits<T>::Reference;
+
+  SoAArray<T, Allocator> *array = nullptr;
+  int index = 0;
+
+  explicit operator bool() const { return array != nullptr; }
+  bool operator==(std::nullptr_t) const { return array == nullptr; }
+  bool operator!=(std::nullptr_t) const { return array != nullptr; }
+
+  Reference operator*() const { return (*array)[index]; }
+  Reference operator->() const { return (*array)[index]; }
+};
+
+// Uniform element access for both layouts: a raw pointer for regular
+// storages and a set of stream pointers for SoA ones.
+template <typename T, typename Allocator>
+T *componentSpan(std::vector<T, Allocator> &components) {
+  return components.data();
+}
+
+template <typename T, typename Allocator>
+SoASpan<T> componentSpan(SoAArray<T, Allocator> &components) {
+  return components.span();
+}
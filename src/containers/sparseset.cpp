@@ -1,59 +1,174 @@
-const int MAX = 12;
-const int SPARSE_FACTOR = 2;
-struct SparseSet {
-  int dense[MAX];
-  int sparse[MAX * SPARSE_FACTOR];
+#pragma once
 
-  SparseSet() {
-    for (int i = 0; i < MAX * SPARSE_FACTOR; i++) {
-      sparse[i] = -1;
+#include "alignedallocator.cpp"
+#include "entity.cpp"
+#include "pagepool.cpp"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// Sparse indices live in fixed-size pages that are only allocated once an
+// entity index in their range is used, so memory follows the live entities
+// instead of the largest index. 4096 ints keeps a page at 16 KiB.
+const int SPARSE_PAGE_SIZE = 4096;
+
+// Returns a sparse page to the allocator it came from.
+template <typename Allocator> struct SparsePageDeleter {
+  RebindAllocator<Allocator, int> allocator;
+
+  void operator()(int *page) {
+    allocator.deallocate(page, SPARSE_PAGE_SIZE);
+  }
+};
+
+// Allocator is used, rebound, for the dense array, the sparse pages and the
+// page table.
+template <typename Allocator = PagePoolAllocator<Entity>>
+struct BasicSparseSet {
+  using SparsePage = std::unique_ptr<int[], SparsePageDeleter<Allocator>>;
+
+  // dense holds full handles, so a stale generation fails contains() even
+  // though it maps to the same sparse slot as the live entity.
+  std::vector<Entity, RebindAllocator<Allocator, Entity>> dense;
+  std::vector<SparsePage, RebindAllocator<Allocator, SparsePage>> sparse;
+
+  explicit BasicSparseSet(const Allocator &allocator = Allocator())
+      : dense(allocator), sparse(allocator) {}
+
+  int size() const { return static_cast<int>(dense.size()); }
+
+  void reserve(int capacity) { dense.reserve(capacity); }
+
+  // Returns the dense index of x, appending it if it was not present yet.
+  int add(Entity x) {
+    int &slot = assure(entityIndex(x));
+    if (slot == -1) {
+      slot = size();
+      dense.push_back(x);
     }
+
+    return slot;
   }
 
-  int n = 0;
-  void add(int x) {
-    dense[n] = x;
-    sparse[x] = n;
-    n++;
+  // Adds every entity in [first, last), reserving once and patching the
+  // sparse side in a single pass. Returns true if none were present yet.
+  template <typename It> bool insert(It first, It last) {
+    dense.reserve(dense.size() + std::distance(first, last));
+    bool allNew = true;
+    for (; first != last; ++first) {
+      int before = size();
+      if (add(*first) != before) {
+        allNew = false;
+      }
+    }
+    return allNew;
   }
 
-  void remove(int x) {
+  void clear() {
+    for (Entity entity : dense) {
+      sparseIndex(entity) = -1;
+    }
+    dense.clear();
+  }
+
+  void remove(Entity x) {
     int index = contains(x);
     if (index == -1) {
       return;
     }
 
-    int last_element = dense[n - 1];
+    Entity last_element = dense.back();
     dense[index] = last_element;
-    sparse[last_element] = index;
+    sparseIndex(last_element) = index;
+    dense.pop_back();
 
-    sparse[x] = -1;
-    --n;
+    sparseIndex(x) = -1;
   }
 
-  int contains(int x) {
-    if (x >= MAX) {
+  int contains(Entity x) const {
+    uint32_t page = entityIndex(x) / SPARSE_PAGE_SIZE;
+    if (page >= sparse.size() || !sparse[page]) {
+      return -1;
+    }
+
+    int index = sparse[page][entityIndex(x) % SPARSE_PAGE_SIZE];
+    if (index == -1 || dense[index] != x) {
       return -1;
     }
 
-    if (sparse[x] != -1 && sparse[x] < n && dense[sparse[x]] == x) {
-      return (sparse[x]);
+    return index;
+  }
+
+  // Exchanges the dense positions a and b, keeping the sparse side in sync.
+  void swap(int a, int b) {
+    Entity first = dense[a];
+    Entity second = dense[b];
+    dense[a] = second;
+    dense[b] = first;
+    sparseIndex(first) = b;
+    sparseIndex(second) = a;
+  }
+
+  // Bytes held by the dense array, the page table and the sparse pages, as
+  // the allocator rounds them.
+  std::size_t memoryUsage() const {
+    std::size_t bytes = capacityBytes(dense) + capacityBytes(sparse);
+    for (const SparsePage &page : sparse) {
+      if (page) {
+        bytes += allocatedBytes(page.get_deleter().allocator, SPARSE_PAGE_SIZE);
+      }
+    }
+    return bytes;
+  }
+
+  // Releases spare dense capacity and the sparse pages no entity uses.
+  void shrinkToFit() {
+    dense.shrink_to_fit();
+    std::vector<bool> used(sparse.size(), false);
+    for (Entity entity : dense) {
+      used[entityIndex(entity) / SPARSE_PAGE_SIZE] = true;
+    }
+    for (std::size_t page = 0; page < sparse.size(); page++) {
+      if (!used[page]) {
+        sparse[page].reset();
+      }
+    }
+    while (!sparse.empty() && !sparse.back()) {
+      sparse.pop_back();
+    }
+    sparse.shrink_to_fit();
+  }
+
+  // The page covering sparse indices [page * SPARSE_PAGE_SIZE, ...),
+  // allocated and filled with -1 if it did not exist yet.
+  int *assurePage(uint32_t page) {
+    if (page >= sparse.size()) {
+      sparse.resize(page + 1);
     }
 
-    return -1;
+    if (!sparse[page]) {
+      SparsePageDeleter<Allocator> deleter{
+          RebindAllocator<Allocator, int>(dense.get_allocator())};
+      sparse[page] =
+          SparsePage(deleter.allocator.allocate(SPARSE_PAGE_SIZE), deleter);
+      for (int i = 0; i < SPARSE_PAGE_SIZE; i++) {
+        sparse[page][i] = -1;
+      }
+    }
+    return sparse[page].get();
   }
 
-  /*void print() {*/
-  /*  std::cout << "Dense: ";*/
-  /*  for (int i = 0; i < n; i++) {*/
-  /*    std::cout << dense[i];*/
-  /*  }*/
-  /*  std::cout << std::endl;*/
-  /**/
-  /*  std::cout << "Sparse: ";*/
-  /*  for (int i = 0; i < MAX; i++) {*/
-  /*    std::cout << sparse[i];*/
-  /*  }*/
-  /*  std::cout << std::endl;*/
-  /*}*/
+  // Unchecked access to the sparse slot of an entity known to be in the set.
+  int &sparseIndex(Entity x) {
+    return sparse[entityIndex(x) / SPARSE_PAGE_SIZE]
+                 [entityIndex(x) % SPARSE_PAGE_SIZE];
+  }
+
+private:
+  int &assure(uint32_t index) {
+    return assurePage(index / SPARSE_PAGE_SIZE)[index % SPARSE_PAGE_SIZE];
+  }
 };
+
+using SparseSet = BasicSparseSet<>;
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "../jobs/threadpool.cpp"
+#include "alignedallocator.cpp"
+#include "componentstorage.cpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+template <typename... Exclude> struct ExcludeList {};
+
+// registry.view<Position, Health>(exclude<Dead>)
+template <typename... Exclude>
+inline constexpr ExcludeList<Exclude...> exclude{};
+
+template <typename Allocator, typename Excludes, typename... Get>
+struct BasicView;
+
+// Walks the dense array of the smallest storage among Get... and probes the
+// others' sparse arrays directly, so each candidate costs one sparse lookup
+// per extra component and nothing for the storage being walked. Allocator is
+// the one of the registry the storages belong to.
+template <typename Allocator, typename... Exclude, typename... Get>
+struct BasicView<Allocator, ExcludeList<Exclude...>, Get...> {
+  static_assert(sizeof...(Get) > 0, "a view needs at least one component");
+
+  template <typename T>
+  using Storage = ComponentStorage<T, RebindAllocator<Allocator, T>>;
+  using Set = BasicSparseSet<RebindAllocator<Allocator, Entity>>;
+
+  std::tuple<Storage<Get> *...> storages;
+  std::tuple<Storage<Exclude> *...> excluded;
+  const Set *pivot = nullptr;
+
+  // Per Get, the tick a component must have changed at or after; only
+  // checked once changed() was used.
+  std::array<uint32_t, sizeof...(Get)> since{};
+  bool filtered = false;
+
+  using Row = std::tuple<Entity, typename Storage<Get>::Reference...>;
+
+  BasicView(std::tuple<Storage<Get> *...> storages,
+       std::tuple<Storage<Exclude> *...> excluded)
+      : storages(storages), excluded(excluded) {
+    std::apply([this](auto *...storage) { (considerPivot(*storage), ...); },
+               storages);
+  }
+
+  // Upper bound on the number of entities the view yields.
+  int sizeHint() const { return pivot->size(); }
+
+  // Narrows the view to entities whose C was constructed or updated at tick
+  // since or later, turning on change tracking for C's storage. If nothing
+  // in that storage changed since then, the view is empty without a walk.
+  // Reader systems may call this concurrently; turning tracking on is
+  // synchronized by the storage.
+  template <typename C> BasicView changed(uint32_t since) const {
+    constexpr std::size_t I = indexOfGet<C>();
+    static_assert(I < sizeof...(Get), "changed<C> needs C among the view's components");
+    Storage<C> &storage = *std::get<I>(storages);
+    storage.trackChanges();
+
+    BasicView result = *this;
+    result.since[I] = since;
+    result.filtered = true;
+    if (storage.version < since) {
+      static const Set none;
+      result.pivot = &none;
+    }
+    return result;
+  }
+
+  bool contains(Entity entity) const {
+    int indices[sizeof...(Get)];
+    return match(entity, -1, indices, std::index_sequence_for<Get...>{});
+  }
+
+  // func is called as func(entity, Get&...) or func(Get&...), with SoA
+  // components passed as their Reference proxy.
+  template <typename Func> void each(Func func) {
+    for (int i = 0; i < pivot->size(); i++) {
+      Entity entity = pivot->dense[i];
+      int indices[sizeof...(Get)];
+      if (match(entity, i, indices, std::index_sequence_for<Get...>{})) {
+        invoke(func, entity, indices, std::index_sequence_for<Get...>{});
+      }
+    }
+  }
+
+  // Like each(), but splits the walked storage into cache-line-aligned
+  // chunks run concurrently on pool, so func must be safe to call from
+  // several threads at once. Components of the walked storage never share a
+  // cache line across chunks; the other storages are visited in the walked
+  // storage's order and can, so prefer a group for write-heavy pairs.
+  template <typename Func>
+  void parallelEach(Func func, ThreadPool &pool = defaultThreadPool()) {
+    parallelFor(pool, pivot->size(), CACHE_LINE_SIZE,
+                [this, &func](int begin, int end) {
+                  for (int i = begin; i < end; i++) {
+                    Entity entity = pivot->dense[i];
+                    int indices[sizeof...(Get)];
+                    if (match(entity, i, indices,
+                              std::index_sequence_for<Get...>{})) {
+                      invoke(func, entity, indices,
+                             std::index_sequence_for<Get...>{});
+                    }
+                  }
+                });
+  }
+
+  struct Iterator {
+    BasicView *view;
+    int position;
+
+    Row operator*() const {
+      Entity entity = view->pivot->dense[position];
+      int indices[sizeof...(Get)] = {};
+      view->match(entity, position, indices, std::index_sequence_for<Get...>{});
+      return view->fetch(entity, indices, std::index_sequence_for<Get...>{});
+    }
+
+    Iterator &operator++() {
+      position = view->nextMatch(position + 1);
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return position == other.position;
+    }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+  };
+
+  // for (auto [entity, position, health] : view)
+  Iterator begin() { return Iterator{this, nextMatch(0)}; }
+  Iterator end() { return Iterator{this, pivot->size()}; }
+
+private:
+  template <typename C> static constexpr std::size_t indexOfGet() {
+    constexpr bool matches[] = {std::is_same_v<C, Get>...};
+    for (std::size_t i = 0; i < sizeof...(Get); i++) {
+      if (matches[i]) {
+        return i;
+      }
+    }
+    return sizeof...(Get);
+  }
+
+  template <typename S> void considerPivot(const S &storage) {
+    if (pivot == nullptr || storage.size() < pivot->size()) {
+      pivot = &storage.sparseSet;
+    }
+  }
+
+  template <std::size_t I> int indexIn(Entity entity, int pivotIndex) const {
+    const Set &set = std::get<I>(storages)->sparseSet;
+    if (&set == pivot && pivotIndex != -1) {
+      return pivotIndex;
+    }
+    return set.contains(entity);
+  }
+
+  template <std::size_t... I>
+  bool match(Entity entity, int pivotIndex, int *indices,
+             std::index_sequence<I...>) const {
+    if (!(((indices[I] = indexIn<I>(entity, pivotIndex)) != -1) && ...)) {
+      return false;
+    }
+    if (filtered &&
+        !(std::get<I>(storages)->changedSince(indices[I], since[I]) && ...)) {
+      return false;
+    }
+    return !isExcluded(entity, std::index_sequence_for<Exclude...>{});
+  }
+
+  template <std::size_t... I>
+  bool isExcluded(Entity entity, std::index_sequence<I...>) const {
+    (void)entity;
+    return ((std::get<I>(excluded)->sparseSet.contains(entity) != -1) || ...);
+  }
+
+  int nextMatch(int position) const {
+    int indices[sizeof...(Get)];
+    while (position < pivot->size() &&
+           !match(pivot->dense[position], position, indices,
+                  std::index_sequence_for<Get...>{})) {
+      position++;
+    }
+    return position;
+  }
+
+  template <std::size_t... I>
+  Row fetch(Entity entity, const int *indices,
+            std::index_sequence<I...>) const {
+    return {entity, std::get<I>(storages)->components[indices[I]]...};
+  }
+
+  template <typename Func, std::size_t... I>
+  void invoke(Func &func, Entity entity, const int *indices,
+              std::index_sequence<I...>) const {
+    if constexpr (std::is_invocable_v<
+                      Func &, Entity,
+                      typename Storage<Get>::Reference...>) {
+      func(entity, std::get<I>(storages)->components[indices[I]]...);
+    } else {
+      func(std::get<I>(storages)->components[indices[I]]...);
+    }
+  }
+};
+
+template <typename Excludes, typename... Get>
+using View = BasicView<PagePoolAllocator<char>, Excludes, Get...>;
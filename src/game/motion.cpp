@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../components/position.cpp"
+#include "../components/velocity.cpp"
+#include "../containers/registry.cpp"
+#include "../math/simd.hpp"
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// Advances every entity in group by velocity * dt. The group keeps both SoA
+// storages in the same order, so this is a single kernel call over six
+// streams. The caller creates the group, since owning Position and Velocity
+// rules out sorting them, other owning groups over them and loadSnapshot.
+// The moved positions are stamped and published through onUpdate like a
+// patch of each.
+inline void integrateMotion(Group<Position, Velocity> group, float dt) {
+  auto &positions = *std::get<0>(group.storages);
+  auto &velocities = std::get<1>(group.storages)->components;
+
+  streamKernels().integrate(
+      positions.components.stream(0), positions.components.stream(1),
+      positions.components.stream(2), velocities.stream(0),
+      velocities.stream(1), velocities.stream(2), dt, group.size());
+  positions.markUpdated(0, group.size());
+}
+
+// Marks which positions lie inside [min, max]. inside is indexed like the
+// Position storage's dense array; returns how many are inside.
+inline int positionsInBounds(Registry &registry, Vector3 min, Vector3 max,
+                             std::vector<uint8_t> &inside) {
+  auto &positions = registry.storage<Position>().components;
+  int count = static_cast<int>(positions.size());
+  inside.resize(count);
+  return streamKernels().inBounds(positions.stream(0), positions.stream(1),
+                                  positions.stream(2), min, max,
+                                  inside.data(), count);
+}
+
+// Squared distance from point to every position, indexed like the Position
+// storage's dense array.
+inline void positionDistancesSquared(Registry &registry, Vector3 point,
+                                     std::vector<float> &distances) {
+  auto &positions = registry.storage<Position>().components;
+  int count = static_cast<int>(positions.size());
+  distances.resize(count);
+  streamKernels().distanceSquared(positions.stream(0), positions.stream(1),
+                                  positions.stream(2), point,
+                                  distances.data(), count);
+}
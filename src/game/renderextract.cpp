@@ -0,0 +1,120 @@
+#pragma once
+
+#include "../components/position.cpp"
+#include "../components/renderable.cpp"
+#include "../containers/registry.cpp"
+#include "../profiler/profiler.cpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Per-instance vertex data, laid out for a vertex binding with
+// VK_VERTEX_INPUT_RATE_INSTANCE: two vec4 attributes.
+struct InstanceData {
+  float x, y, z, scale;
+  float r, g, b, a;
+};
+
+// Instances firstInstance .. firstInstance + instanceCount of the extracted
+// array all use mesh, so each batch is one instanced draw.
+struct MeshBatch {
+  uint32_t mesh;
+  uint32_t firstInstance;
+  uint32_t instanceCount;
+};
+
+// World-space rectangle in x/y; entities whose scaled extent misses it are
+// culled.
+struct RenderView {
+  float minX, minY, maxX, maxY;
+};
+
+// Turns every visible entity with a Position and a Renderable into an
+// InstanceData, grouped by mesh. gather() finds the visible entities and
+// sizes the batches, so the caller can allocate exactly that much before
+// write() fills it in, typically straight into mapped GPU memory.
+struct RenderExtractor {
+  // Returns how many instances write() will produce.
+  uint32_t gather(Registry &registry, const RenderView &view) {
+    GW_PROFILE_SCOPE("RenderExtractor::gather");
+    auto &renderables = registry.storage<Renderable>();
+    auto &positions = registry.storage<Position>();
+    const float *x = positions.components.stream(0);
+    const float *y = positions.components.stream(1);
+
+    visible.clear();
+    std::fill(meshCounts.begin(), meshCounts.end(), 0);
+    for (int i = 0; i < renderables.size(); i++) {
+      int index = positions.sparseSet.contains(renderables.sparseSet.dense[i]);
+      if (index == -1) {
+        continue;
+      }
+      const Renderable &renderable = renderables.components[i];
+      float extent = renderable.scale;
+      if (x[index] + extent < view.minX || x[index] - extent > view.maxX ||
+          y[index] + extent < view.minY || y[index] - extent > view.maxY) {
+        continue;
+      }
+      if (renderable.mesh >= meshCounts.size()) {
+        meshCounts.resize(renderable.mesh + 1, 0);
+      }
+      meshCounts[renderable.mesh]++;
+      visible.push_back({i, index});
+    }
+    return static_cast<uint32_t>(visible.size());
+  }
+
+  // Writes at most capacity of the gathered instances to out, mesh by mesh,
+  // and rebuilds batches() to match. Registry must be unchanged since
+  // gather().
+  void write(Registry &registry, InstanceData *out, uint32_t capacity) {
+    GW_PROFILE_SCOPE("RenderExtractor::write");
+    auto &renderables = registry.storage<Renderable>();
+    auto &positions = registry.storage<Position>();
+    const float *x = positions.components.stream(0);
+    const float *y = positions.components.stream(1);
+    const float *z = positions.components.stream(2);
+
+    meshBatches.clear();
+    cursors.resize(meshCounts.size());
+    ends.resize(meshCounts.size());
+    uint32_t first = 0;
+    for (uint32_t mesh = 0; mesh < meshCounts.size(); mesh++) {
+      uint32_t count = std::min(meshCounts[mesh], capacity - first);
+      cursors[mesh] = first;
+      ends[mesh] = first + count;
+      if (count > 0) {
+        meshBatches.push_back({mesh, first, count});
+      }
+      first += count;
+    }
+
+    for (const Visible &entry : visible) {
+      const Renderable &renderable = renderables.components[entry.renderable];
+      uint32_t &cursor = cursors[renderable.mesh];
+      if (cursor == ends[renderable.mesh]) {
+        continue;
+      }
+      out[cursor++] = {x[entry.position], y[entry.position],
+                       z[entry.position], renderable.scale,
+                       renderable.r,      renderable.g,
+                       renderable.b,      1.0f};
+    }
+  }
+
+  const std::vector<MeshBatch> &batches() const { return meshBatches; }
+
+private:
+  struct Visible {
+    int renderable;
+    int position;
+  };
+
+  std::vector<Visible> visible;
+  std::vector<uint32_t> meshCounts;
+  // Next free slot and end of each mesh's range while writing.
+  std::vector<uint32_t> cursors;
+  std::vector<uint32_t> ends;
+  std::vector<MeshBatch> meshBatches;
+};
@@ -1,5 +1,43 @@
+#pragma once
+
+#include "../containers/archetyperegistry.cpp"
+#include "../containers/commandbuffer.cpp"
 #include "../containers/registry.cpp"
+#include "../profiler/profiler.cpp"
+#include "scheduler.cpp"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+// Backend is the entity/component store: Registry keeps one sparse set per
+// component type, ArchetypeRegistry packs entities with the same component
+// set into shared chunks. Both expose the same create/add/get/view API.
+template <typename Backend = Registry> struct BasicScene {
+  Backend registry;
+  SystemScheduler<Backend> systems;
 
-struct Scene {
-  Registry registry;
+  // Systems record structural changes here instead of making them while
+  // other systems iterate; they are applied at the end of update().
+  CommandQueue<Backend> commands{registry};
+
+  // update only touches the components declared in reads and writes.
+  template <typename... Reads, typename... Writes>
+  void addSystem(std::string name, Read<Reads...> reads, Write<Writes...> writes,
+                 std::function<void(Backend &)> update) {
+    systems.addSystem(std::move(name), reads, writes, std::move(update));
+  }
+
+  void update() {
+    GW_PROFILE_SCOPE("Scene::update");
+    systems.run(registry);
+    {
+      GW_PROFILE_SCOPE("CommandQueue::playback");
+      commands.playback();
+    }
+    registry.advanceTick();
+  }
 };
+
+using Scene = BasicScene<Registry>;
+using ArchetypeScene = BasicScene<ArchetypeRegistry>;
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "../containers/componenttype.cpp"
+#include "../jobs/threadpool.cpp"
+#include "../profiler/profiler.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Component access declarations for addSystem:
+//   scene.addSystem("movement", Read<Velocity>{}, Write<Position>{}, update);
+template <typename... T> struct Read {};
+template <typename... T> struct Write {};
+
+enum class ScheduleMode {
+  // Systems without conflicting access run concurrently on the thread pool.
+  Parallel,
+  // Systems run one after another in registration order on the calling
+  // thread, for debugging.
+  Serial,
+};
+
+// Runs a Scene's systems once per frame. Two systems conflict when one writes
+// a component the other reads or writes; conflicting systems run in the order
+// they were registered, everything else may overlap.
+template <typename Backend> struct SystemScheduler {
+  ScheduleMode mode = ScheduleMode::Parallel;
+
+  template <typename... Reads, typename... Writes>
+  void addSystem(std::string name, Read<Reads...>, Write<Writes...>,
+                 std::function<void(Backend &)> update) {
+    System system;
+    system.name = std::move(name);
+    system.profileName = profiler().intern(system.name);
+    system.reads = {componentTypeId<Reads>()...};
+    system.writes = {componentTypeId<Writes>()...};
+    system.update = std::move(update);
+    // Systems running in parallel must not create storages behind each
+    // other's backs, so make sure every declared one exists up front; run()
+    // locks the rest, so a use missing from the declaration asserts.
+    system.prepare = [](Backend &registry) {
+      (registry.template view<Reads>(), ...);
+      (registry.template view<Writes>(), ...);
+    };
+    systems.push_back(std::move(system));
+    graphDirty = true;
+  }
+
+  void run(Backend &registry, ThreadPool &pool = defaultThreadPool()) {
+    if (systems.empty()) {
+      return;
+    }
+
+    if (mode == ScheduleMode::Serial) {
+      for (System &system : systems) {
+        GW_PROFILE_SCOPE(system.profileName);
+        system.update(registry);
+      }
+      return;
+    }
+
+    if (graphDirty) {
+      buildGraph();
+    }
+    for (System &system : systems) {
+      system.prepare(registry);
+      system.remaining.store(system.dependencyCount);
+    }
+
+    TaskGroup frame;
+    firstError = nullptr;
+    registry.lockStorages(true);
+    for (int i = 0; i < static_cast<int>(systems.size()); i++) {
+      if (systems[i].dependencyCount == 0) {
+        launch(i, registry, pool, frame);
+      }
+    }
+    pool.wait(frame);
+    registry.lockStorages(false);
+
+    if (firstError) {
+      std::rethrow_exception(firstError);
+    }
+  }
+
+private:
+  struct System {
+    std::string name;
+    // name interned in the profiler, which keeps pointers to it.
+    const char *profileName = nullptr;
+    std::vector<int> reads;
+    std::vector<int> writes;
+    std::function<void(Backend &)> update;
+    std::function<void(Backend &)> prepare;
+
+    std::vector<int> dependents;
+    int dependencyCount = 0;
+    std::atomic<int> remaining{0};
+
+    System() = default;
+    System(System &&other) noexcept
+        : name(std::move(other.name)), profileName(other.profileName),
+          reads(std::move(other.reads)),
+          writes(std::move(other.writes)), update(std::move(other.update)),
+          prepare(std::move(other.prepare)),
+          dependents(std::move(other.dependents)),
+          dependencyCount(other.dependencyCount) {}
+  };
+
+  std::vector<System> systems;
+  bool graphDirty = false;
+  std::mutex errorMutex;
+  std::exception_ptr firstError;
+
+  static bool overlaps(const std::vector<int> &a, const std::vector<int> &b) {
+    for (int type : a) {
+      if (std::find(b.begin(), b.end(), type) != b.end()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool conflicts(const System &a, const System &b) {
+    return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) ||
+           overlaps(a.reads, b.writes);
+  }
+
+  void buildGraph() {
+    for (System &system : systems) {
+      system.dependents.clear();
+      system.dependencyCount = 0;
+    }
+
+    for (int later = 0; later < static_cast<int>(systems.size()); later++) {
+      for (int earlier = 0; earlier < later; earlier++) {
+        if (conflicts(systems[earlier], systems[later])) {
+          systems[earlier].dependents.push_back(later);
+          systems[later].dependencyCount++;
+        }
+      }
+    }
+    graphDirty = false;
+  }
+
+  void launch(int index, Backend &registry, ThreadPool &pool,
+              TaskGroup &frame) {
+    pool.submit(frame, [this, index, &registry, &pool, &frame] {
+      System &system = systems[index];
+      try {
+        GW_PROFILE_SCOPE(system.profileName);
+        system.update(registry);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!firstError) {
+          firstError = std::current_exception();
+        }
+      }
+
+      for (int dependent : system.dependents) {
+        if (systems[dependent].remaining.fetch_sub(1) == 1) {
+          launch(dependent, registry, pool, frame);
+        }
+      }
+    });
+  }
+};
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "../assets/mappedfile.cpp"
+#include "../containers/registry.cpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Snapshot file layout, all little-endian as written by the host:
+//
+//   SnapshotHeader
+//   entity blob (entityCount handles, the registry's EntityPool)
+//   per storage: SnapshotSection, dense entity blob, page number blob,
+//                sparse pages, then one component blob per SoA stream (or a
+//                single one for regular components)
+//
+// Every blob starts on a SNAPSHOT_ALIGNMENT boundary, so a mapped file can be
+// read in place with aligned loads. Components are identified by their
+// position in the type list given to save and load, which must match.
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint64_t SNAPSHOT_ALIGNMENT = 64;
+const char SNAPSHOT_MAGIC[8] = {'G', 'W', 'S', 'N', 'A', 'P', 0, 0};
+
+const uint32_t SNAPSHOT_DELTA = 1 << 0;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  // For a delta, the tick passed to saveDeltaSnapshot.
+  uint32_t sinceTick;
+  uint32_t sectionCount;
+  uint32_t entityCount;
+  uint32_t freeList;
+};
+
+struct SnapshotSection {
+  uint32_t typeIndex;
+  uint32_t elementSize;
+  uint32_t streamCount;
+  uint32_t count;
+  uint32_t pageCount;
+  uint32_t reserved;
+};
+
+namespace snapshot_detail {
+
+struct Writer {
+  std::ofstream out;
+  uint64_t offset = 0;
+
+  void write(const void *bytes, uint64_t count) {
+    out.write(static_cast<const char *>(bytes),
+              static_cast<std::streamsize>(count));
+    offset += count;
+  }
+
+  void blob(const void *bytes, uint64_t count) {
+    static const char zeros[SNAPSHOT_ALIGNMENT] = {};
+    uint64_t padding = (SNAPSHOT_ALIGNMENT - offset % SNAPSHOT_ALIGNMENT) %
+                       SNAPSHOT_ALIGNMENT;
+    write(zeros, padding);
+    write(bytes, count);
+  }
+};
+
+struct Reader {
+  const unsigned char *data;
+  uint64_t size;
+  uint64_t offset = 0;
+
+  // Returns the next blob of count bytes, or null past the end of the file.
+  const void *blob(uint64_t count) {
+    offset = (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT *
+             SNAPSHOT_ALIGNMENT;
+    if (offset > size || count > size - offset) {
+      return nullptr;
+    }
+    const void *result = data + offset;
+    offset += count;
+    return result;
+  }
+};
+
+// Element size and number of component blobs of a T section. Tags write no
+// component data at all.
+template <typename T> std::pair<uint32_t, uint32_t> componentLayout() {
+  if constexpr (std::is_empty_v<T>) {
+    return {0, 0};
+  } else if constexpr (SoATraits<T>::enabled) {
+    return {sizeof(typename SoATraits<T>::Scalar), SoATraits<T>::streamCount};
+  } else {
+    return {sizeof(T), 1};
+  }
+}
+
+template <typename T, typename Allocator>
+void writeStorage(Writer &writer, ComponentStorage<T, Allocator> &storage,
+                  uint32_t typeIndex) {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "snapshots copy components as raw bytes");
+
+  const auto &set = storage.sparseSet;
+  std::vector<uint32_t> pages;
+  for (uint32_t page = 0; page < set.sparse.size(); page++) {
+    if (set.sparse[page]) {
+      pages.push_back(page);
+    }
+  }
+
+  SnapshotSection section = {};
+  section.typeIndex = typeIndex;
+  section.count = static_cast<uint32_t>(set.size());
+  section.pageCount = static_cast<uint32_t>(pages.size());
+  section.elementSize = componentLayout<T>().first;
+  section.streamCount = componentLayout<T>().second;
+
+  writer.blob(&section, sizeof(section));
+  writer.blob(set.dense.data(), sizeof(Entity) * section.count);
+  writer.blob(pages.data(), sizeof(uint32_t) * pages.size());
+  for (uint32_t page : pages) {
+    writer.blob(set.sparse[page].get(), sizeof(int) * SPARSE_PAGE_SIZE);
+  }
+
+  if constexpr (SoATraits<T>::enabled) {
+    for (auto &stream : storage.components.streams) {
+      writer.blob(stream.data(), section.elementSize * section.count);
+    }
+  } else if constexpr (!std::is_empty_v<T>) {
+    writer.blob(storage.components.data(), sizeof(T) * section.count);
+  }
+}
+
+// Replaces the contents of storage with the section at reader. Signals are
+// not published; change tracking sees every loaded component as changed.
+template <typename T, typename Allocator>
+bool readStorage(Reader &reader, const SnapshotSection &section,
+                 ComponentStorage<T, Allocator> &storage) {
+  assert(storage.group == nullptr);
+
+  uint32_t elementSize = componentLayout<T>().first;
+  uint32_t streamCount = componentLayout<T>().second;
+  if (section.elementSize != elementSize ||
+      section.streamCount != streamCount) {
+    return false;
+  }
+
+  auto *dense = static_cast<const Entity *>(
+      reader.blob(sizeof(Entity) * section.count));
+  auto *pages = static_cast<const uint32_t *>(
+      reader.blob(sizeof(uint32_t) * section.pageCount));
+  if (dense == nullptr || pages == nullptr) {
+    return false;
+  }
+  std::vector<const int *> sparse(section.pageCount);
+  for (const int *&page : sparse) {
+    page = static_cast<const int *>(
+        reader.blob(sizeof(int) * SPARSE_PAGE_SIZE));
+    if (page == nullptr) {
+      return false;
+    }
+  }
+  std::vector<const void *> streams(streamCount);
+  for (const void *&stream : streams) {
+    stream = reader.blob(uint64_t(elementSize) * section.count);
+    if (stream == nullptr) {
+      return false;
+    }
+  }
+
+  // Everything is checked before storage is touched. Pages past the entity
+  // index space, sparse values outside the dense array, or dense entries
+  // their sparse slot doesn't point back to would make later lookups and
+  // removals read out of bounds. Pages are saved in ascending order.
+  const uint32_t pageLimit = ENTITY_INDEX_MASK / SPARSE_PAGE_SIZE + 1;
+  for (uint32_t i = 0; i < section.pageCount; i++) {
+    if (pages[i] >= pageLimit || (i > 0 && pages[i] <= pages[i - 1])) {
+      return false;
+    }
+    for (int j = 0; j < SPARSE_PAGE_SIZE; j++) {
+      if (sparse[i][j] < -1 ||
+          sparse[i][j] >= static_cast<int64_t>(section.count)) {
+        return false;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < section.count; i++) {
+    uint32_t index = entityIndex(dense[i]);
+    const uint32_t *page = std::lower_bound(
+        pages, pages + section.pageCount, index / SPARSE_PAGE_SIZE);
+    if (page == pages + section.pageCount ||
+        *page != index / SPARSE_PAGE_SIZE ||
+        sparse[page - pages][index % SPARSE_PAGE_SIZE] !=
+            static_cast<int>(i)) {
+      return false;
+    }
+  }
+
+  auto &set = storage.sparseSet;
+  set.sparse.clear();
+  for (uint32_t i = 0; i < section.pageCount; i++) {
+    std::memcpy(set.assurePage(pages[i]), sparse[i],
+                sizeof(int) * SPARSE_PAGE_SIZE);
+  }
+  set.dense.assign(dense, dense + section.count);
+
+  if constexpr (std::is_empty_v<T>) {
+    storage.components.resize(section.count);
+  } else if constexpr (SoATraits<T>::enabled) {
+    for (uint32_t stream = 0; stream < streamCount; stream++) {
+      auto *scalars =
+          static_cast<const typename SoATraits<T>::Scalar *>(streams[stream]);
+      storage.components.streams[stream].assign(scalars,
+                                                scalars + section.count);
+    }
+  } else {
+    auto *components = static_cast<const T *>(streams[0]);
+    storage.components.assign(components, components + section.count);
+  }
+
+  storage.version = storage.tick;
+  if (storage.tracking) {
+    storage.changeTicks.assign(section.count, storage.tick);
+  }
+  return true;
+}
+
+// Whether a saved entity table is one an EntityPool could have built: no
+// more than MAX_ENTITIES slots, and a free list that stays inside the table,
+// only visits free slots and ends.
+inline bool validEntityTable(const Entity *entities, uint32_t count,
+                             uint32_t freeList) {
+  if (count > MAX_ENTITIES) {
+    return false;
+  }
+  uint32_t index = freeList;
+  for (uint32_t steps = 0; index != ENTITY_INDEX_MASK; steps++) {
+    if (index >= count || steps == count ||
+        entityIndex(entities[index]) == index) {
+      return false;
+    }
+    index = entityIndex(entities[index]);
+  }
+  return true;
+}
+
+template <typename... T, std::size_t... I>
+bool writeSnapshot(Registry &registry, const std::string &path,
+                   uint32_t flags, uint32_t sinceTick,
+                   std::index_sequence<I...>) {
+  Writer writer;
+  writer.out.open(path, std::ios::binary | std::ios::trunc);
+  if (!writer.out) {
+    return false;
+  }
+
+  bool include[] = {(!(flags & SNAPSHOT_DELTA) ||
+                     registry.storage<T>().version >= sinceTick)...};
+
+  EntityPool &pool = registry.pool();
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.flags = flags;
+  header.sinceTick = sinceTick;
+  header.sectionCount = 0;
+  for (bool included : include) {
+    header.sectionCount += included ? 1 : 0;
+  }
+  header.entityCount = static_cast<uint32_t>(pool.entities.size());
+  header.freeList = pool.freeList;
+
+  writer.write(&header, sizeof(header));
+  writer.blob(pool.entities.data(), sizeof(Entity) * header.entityCount);
+  ((include[I] ? writeStorage(writer, registry.storage<T>(), I) : void()), ...);
+
+  writer.out.flush();
+  return static_cast<bool>(writer.out);
+}
+
+template <typename... T, std::size_t... I>
+bool readSection(Registry &registry, Reader &reader,
+                 const SnapshotSection &section, std::index_sequence<I...>) {
+  bool result = false;
+  ((section.typeIndex == I
+        ? (result = readStorage(reader, section, registry.storage<T>()), 0)
+        : 0),
+   ...);
+  return result;
+}
+
+} // namespace snapshot_detail
+
+// Writes the entity table and the storages of T... to path. Every T must be
+// trivially copyable. Returns false if the file could not be written.
+template <typename... T>
+bool saveSnapshot(Registry &registry, const std::string &path) {
+  return snapshot_detail::writeSnapshot<T...>(
+      registry, path, 0, 0, std::index_sequence_for<T...>{});
+}
+
+// Like saveSnapshot, but only writes the storages whose version is at or
+// after sinceTick (usually the registry tick of the previous save). Load it
+// on top of the registry state it was taken against. Only writes that stamp
+// the storage count: add, remove, replace, patch, insert and markUpdated.
+// Components assigned through getComponent, a view or a group since the
+// last save are missed unless the storage was stamped afterwards.
+template <typename... T>
+bool saveDeltaSnapshot(Registry &registry, const std::string &path,
+                       uint32_t sinceTick) {
+  return snapshot_detail::writeSnapshot<T...>(
+      registry, path, SNAPSHOT_DELTA, sinceTick,
+      std::index_sequence_for<T...>{});
+}
+
+// Maps path and copies its blobs straight into the registry: the entity
+// table, dense arrays, sparse pages and component arrays are each one bulk
+// copy. Before that is trusted, one validation pass walks the free list,
+// each dense array and each sparse page. A full snapshot first clears the
+// registry; a delta replaces only the storages it contains. T... must list
+// the same types in the same order as when saving, and none of them may be
+// owned by a group. Returns false on a missing, foreign, truncated or
+// malformed file (an entity table whose free list leaves the table, visits
+// a live slot or loops; a section that doesn't match its type; sparse pages
+// outside the entity index space; or sparse and dense arrays that don't
+// point at each other). In that case the registry may be partly loaded,
+// but never with an inconsistent table or storage.
+template <typename... T>
+bool loadSnapshot(Registry &registry, const std::string &path) {
+  MappedFile file(path);
+  if (file.data == nullptr || file.size < sizeof(SnapshotHeader)) {
+    return false;
+  }
+
+  SnapshotHeader header;
+  std::memcpy(&header, file.data, sizeof(header));
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != SNAPSHOT_VERSION) {
+    return false;
+  }
+
+  snapshot_detail::Reader reader{file.data, file.size, sizeof(header)};
+  auto *entities = static_cast<const Entity *>(
+      reader.blob(sizeof(Entity) * header.entityCount));
+  if (entities == nullptr ||
+      !snapshot_detail::validEntityTable(entities, header.entityCount,
+                                         header.freeList)) {
+    return false;
+  }
+
+  if (!(header.flags & SNAPSHOT_DELTA)) {
+    registry.clear();
+  }
+  EntityPool &pool = registry.pool();
+  pool.flushReserved();
+  pool.entities.assign(entities, entities + header.entityCount);
+  pool.freeList = header.freeList;
+
+  for (uint32_t i = 0; i < header.sectionCount; i++) {
+    auto *section = static_cast<const SnapshotSection *>(
+        reader.blob(sizeof(SnapshotSection)));
+    if (section == nullptr || section->typeIndex >= sizeof...(T) ||
+        !snapshot_detail::readSection<T...>(registry, reader, *section,
+                                            std::index_sequence_for<T...>{})) {
+      return false;
+    }
+  }
+  return true;
+}
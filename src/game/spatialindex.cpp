@@ -0,0 +1,462 @@
+#pragma once
+
+#include "../components/position.cpp"
+#include "../containers/registry.cpp"
+#include "../jobs/threadpool.cpp"
+#include "../math/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Uniform hash grid over the Position of every entity that has one. It
+// follows the Position storage's onConstruct, onUpdate and onDestroy signals;
+// writes that bypass them, such as assigning through a view, are picked up
+// by refresh(). Cells keep their entities' coordinates as x/y/z streams, so
+// queries run the SIMD distance kernel over each cell and never go back to
+// the registry. The grid spans 2^21 cells per axis around the origin;
+// positions beyond that are kept in the outermost cells.
+struct SpatialIndex {
+  explicit SpatialIndex(Registry &registry, float cellSize = 4.0f)
+      : registry(&registry), cellSize(cellSize),
+        inverseCellSize(1.0f / cellSize) {
+    auto &storage = registry.storage<Position>();
+    connections[0] = storage.onConstruct.connect(
+        [this](Entity entity) { insert(entity, position(entity)); });
+    connections[1] = storage.onUpdate.connect(
+        [this](Entity entity) { move(entity, position(entity)); });
+    connections[2] =
+        storage.onDestroy.connect([this](Entity entity) { remove(entity); });
+
+    for (int i = 0; i < storage.size(); i++) {
+      insert(storage.sparseSet.dense[i], storage.components[i]);
+    }
+  }
+
+  ~SpatialIndex() {
+    auto &storage = registry->storage<Position>();
+    storage.onConstruct.disconnect(connections[0]);
+    storage.onUpdate.disconnect(connections[1]);
+    storage.onDestroy.disconnect(connections[2]);
+  }
+
+  SpatialIndex(const SpatialIndex &) = delete;
+  SpatialIndex &operator=(const SpatialIndex &) = delete;
+
+  int size() const { return count; }
+
+  // Re-reads every Position, moving the entities whose cell changed.
+  void refresh() {
+    auto &storage = registry->storage<Position>();
+    auto &positions = storage.components;
+    const float *x = positions.stream(0);
+    const float *y = positions.stream(1);
+    const float *z = positions.stream(2);
+    for (int i = 0; i < storage.size(); i++) {
+      move(storage.sparseSet.dense[i], Position(x[i], y[i], z[i]));
+    }
+  }
+
+  // Entities within radius of center, in no particular order.
+  void queryRadius(Vector3 center, float radius,
+                   std::vector<Entity> &out) const {
+    out.clear();
+    CellCoord low = coordOf(center.x - radius, center.y - radius,
+                            center.z - radius);
+    CellCoord high = coordOf(center.x + radius, center.y + radius,
+                             center.z + radius);
+    float radiusSquared = radius * radius;
+    std::vector<float> distances;
+    forCells(low, high, [&](const Cell &cell) {
+      distancesTo(cell, center, distances);
+      for (std::size_t i = 0; i < cell.entities.size(); i++) {
+        if (distances[i] <= radiusSquared) {
+          out.push_back(cell.entities[i]);
+        }
+      }
+    });
+  }
+
+  // Entities inside [min, max] on every axis, in no particular order.
+  void queryBox(Vector3 min, Vector3 max, std::vector<Entity> &out) const {
+    out.clear();
+    std::vector<uint8_t> inside;
+    forCells(coordOf(min.x, min.y, min.z), coordOf(max.x, max.y, max.z),
+             [&](const Cell &cell) {
+               int cellCount = static_cast<int>(cell.entities.size());
+               inside.resize(cellCount);
+               streamKernels().inBounds(cell.x.data(), cell.y.data(),
+                                        cell.z.data(), min, max,
+                                        inside.data(), cellCount);
+               for (int i = 0; i < cellCount; i++) {
+                 if (inside[i]) {
+                   out.push_back(cell.entities[i]);
+                 }
+               }
+             });
+  }
+
+  // The k entities closest to point, nearest first. Searches rings of cells
+  // outward from point's cell until no unvisited cell can beat the current
+  // k-th distance; falls back to visiting every cell once a ring would hold
+  // more cells than the grid does.
+  void nearest(Vector3 point, int k, std::vector<Entity> &out) const {
+    out.clear();
+    if (k <= 0 || count == 0) {
+      return;
+    }
+
+    using Candidate = std::pair<float, Entity>;
+    std::priority_queue<Candidate> best;
+    std::vector<float> distances;
+    auto consider = [&](const Cell &cell) {
+      distancesTo(cell, point, distances);
+      for (std::size_t i = 0; i < cell.entities.size(); i++) {
+        if (static_cast<int>(best.size()) < k) {
+          best.emplace(distances[i], cell.entities[i]);
+        } else if (distances[i] < best.top().first) {
+          best.pop();
+          best.emplace(distances[i], cell.entities[i]);
+        }
+      }
+    };
+
+    CellCoord center = coordOf(point.x, point.y, point.z);
+    for (int ring = 0;; ring++) {
+      double side = 2.0 * ring + 1.0;
+      if (side * side * side > 8.0 * static_cast<double>(cells.size())) {
+        best = {};
+        for (const auto &entry : cells) {
+          consider(entry.second);
+        }
+        break;
+      }
+
+      forRing(center, ring, consider);
+
+      // Clamping never moves two positions' cells further apart than they
+      // really are, so unvisited cells stay at least this far away even
+      // when some of them are clamped border cells.
+      float reach = ring * cellSize;
+      if (static_cast<int>(best.size()) == std::min(k, count) &&
+          (static_cast<int>(best.size()) == count ||
+           best.top().first <= reach * reach)) {
+        break;
+      }
+    }
+
+    out.resize(best.size());
+    for (int i = static_cast<int>(best.size()) - 1; i >= 0; i--) {
+      out[i] = best.top().second;
+      best.pop();
+    }
+  }
+
+  // Every unordered pair of entities at most radius apart. Cells are split
+  // across pool, each comparing itself and the neighbours that come after it
+  // in (x, y, z) order, so every pair is tested exactly once.
+  void pairsWithin(float radius, std::vector<std::pair<Entity, Entity>> &out,
+                   ThreadPool &pool = defaultThreadPool()) const {
+    out.clear();
+    std::vector<const Cell *> all;
+    all.reserve(cells.size());
+    for (const auto &entry : cells) {
+      all.push_back(&entry.second);
+    }
+
+    int reach = static_cast<int>(std::ceil(radius * inverseCellSize));
+    float radiusSquared = radius * radius;
+    std::mutex outMutex;
+
+    parallelFor(pool, static_cast<int>(all.size()), 16,
+                [&](int begin, int end) {
+                  std::vector<std::pair<Entity, Entity>> found;
+                  std::vector<float> distances;
+                  for (int c = begin; c < end; c++) {
+                    const Cell &cell = *all[c];
+                    pairsInCell(cell, radiusSquared, distances, found);
+                    forForwardNeighbours(cell.coord, reach,
+                                         [&](const Cell &other) {
+                                           pairsBetween(cell, other,
+                                                        radiusSquared,
+                                                        distances, found);
+                                         });
+                  }
+
+                  std::lock_guard<std::mutex> lock(outMutex);
+                  out.insert(out.end(), found.begin(), found.end());
+                });
+  }
+
+  void insert(Entity entity, Position at) {
+    uint32_t index = entityIndex(entity);
+    if (index >= slots.size()) {
+      slots.resize(index + 1);
+    }
+    if (slots[index].position != -1) {
+      move(entity, at);
+      return;
+    }
+
+    CellCoord coord = coordOf(at.x, at.y, at.z);
+    uint64_t key = keyOf(coord);
+    Cell &cell = cells[key];
+    cell.coord = coord;
+    slots[index] = {key, &cell, static_cast<int>(cell.entities.size())};
+    cell.entities.push_back(entity);
+    cell.x.push_back(at.x);
+    cell.y.push_back(at.y);
+    cell.z.push_back(at.z);
+    count++;
+  }
+
+  void remove(Entity entity) {
+    uint32_t index = entityIndex(entity);
+    if (index >= slots.size() || slots[index].position == -1) {
+      return;
+    }
+
+    Slot &slot = slots[index];
+    Cell &cell = *slot.cell;
+    int last = static_cast<int>(cell.entities.size()) - 1;
+    if (slot.position != last) {
+      cell.entities[slot.position] = cell.entities[last];
+      cell.x[slot.position] = cell.x[last];
+      cell.y[slot.position] = cell.y[last];
+      cell.z[slot.position] = cell.z[last];
+      slots[entityIndex(cell.entities[last])].position = slot.position;
+    }
+    cell.entities.pop_back();
+    cell.x.pop_back();
+    cell.y.pop_back();
+    cell.z.pop_back();
+    if (cell.entities.empty()) {
+      cells.erase(slot.key);
+    }
+
+    slot.position = -1;
+    count--;
+  }
+
+  void move(Entity entity, Position to) {
+    uint32_t index = entityIndex(entity);
+    if (index >= slots.size() || slots[index].position == -1) {
+      insert(entity, to);
+      return;
+    }
+
+    Slot &slot = slots[index];
+    if (keyOf(coordOf(to.x, to.y, to.z)) != slot.key) {
+      remove(entity);
+      insert(entity, to);
+      return;
+    }
+
+    Cell &cell = *slot.cell;
+    cell.x[slot.position] = to.x;
+    cell.y[slot.position] = to.y;
+    cell.z[slot.position] = to.z;
+  }
+
+private:
+  struct CellCoord {
+    int x, y, z;
+  };
+
+  struct Cell {
+    CellCoord coord;
+    std::vector<Entity> entities;
+    std::vector<float> x, y, z;
+  };
+
+  // Where an entity sits, indexed by entity index; position is -1 for
+  // entities not in the index. Map nodes never move, so cell stays valid
+  // until the cell is erased, which only happens once it is empty.
+  struct Slot {
+    uint64_t key = 0;
+    Cell *cell = nullptr;
+    int position = -1;
+  };
+
+  // Cell coordinates are packed into 21 bits per axis around this bias, so
+  // each axis spans [-COORD_BIAS, COORD_BIAS) cells.
+  static constexpr int COORD_BIAS = 1 << 20;
+  static constexpr uint64_t COORD_MASK = (1u << 21) - 1;
+
+  Registry *registry;
+  float cellSize;
+  float inverseCellSize;
+  std::unordered_map<uint64_t, Cell> cells;
+  std::vector<Slot> slots;
+  int count = 0;
+  int connections[3];
+
+  Position position(Entity entity) {
+    return *registry->getComponent<Position>(entity);
+  }
+
+  CellCoord coordOf(float x, float y, float z) const {
+    return {axisOf(x), axisOf(y), axisOf(z)};
+  }
+
+  // Positions past the packable range share the outermost cell of their
+  // axis. Cells keep exact coordinates and boundsOf treats those cells as
+  // open-ended, so results stay correct; only the culling gets coarser out
+  // there. NaN lands in the lowest cell.
+  int axisOf(float value) const {
+    float cell = std::floor(value * inverseCellSize);
+    if (!(cell >= -COORD_BIAS)) {
+      return -COORD_BIAS;
+    }
+    return static_cast<int>(std::min(cell, float(COORD_BIAS - 1)));
+  }
+
+  // The span a cell covers along one axis. The outermost cells also hold
+  // every position clamped into them, so they are open towards the outside.
+  void boundsOf(int axis, float &low, float &high) const {
+    low = axis == -COORD_BIAS ? -std::numeric_limits<float>::infinity()
+                              : axis * cellSize;
+    high = axis == COORD_BIAS - 1 ? std::numeric_limits<float>::infinity()
+                                  : (axis + 1) * cellSize;
+  }
+
+  static bool packable(int axis) {
+    return axis >= -COORD_BIAS && axis < COORD_BIAS;
+  }
+
+  static uint64_t keyOf(CellCoord coord) {
+    return (static_cast<uint64_t>(coord.x + COORD_BIAS) & COORD_MASK) |
+           ((static_cast<uint64_t>(coord.y + COORD_BIAS) & COORD_MASK) << 21) |
+           ((static_cast<uint64_t>(coord.z + COORD_BIAS) & COORD_MASK) << 42);
+  }
+
+  // Neighbour walks can step past the packable range, where keys would wrap
+  // onto cells at the other end.
+  const Cell *find(int x, int y, int z) const {
+    if (!packable(x) || !packable(y) || !packable(z)) {
+      return nullptr;
+    }
+    auto found = cells.find(keyOf({x, y, z}));
+    return found != cells.end() ? &found->second : nullptr;
+  }
+
+  // Visits the occupied cells in [low, high], or every occupied cell when
+  // that range holds more cells than the grid does.
+  template <typename Func>
+  void forCells(CellCoord low, CellCoord high, Func func) const {
+    double span = (double(high.x) - low.x + 1) * (double(high.y) - low.y + 1) *
+                  (double(high.z) - low.z + 1);
+    if (span > static_cast<double>(cells.size())) {
+      for (const auto &entry : cells) {
+        const CellCoord &c = entry.second.coord;
+        if (c.x >= low.x && c.x <= high.x && c.y >= low.y && c.y <= high.y &&
+            c.z >= low.z && c.z <= high.z) {
+          func(entry.second);
+        }
+      }
+      return;
+    }
+
+    for (int x = low.x; x <= high.x; x++) {
+      for (int y = low.y; y <= high.y; y++) {
+        for (int z = low.z; z <= high.z; z++) {
+          if (const Cell *cell = find(x, y, z)) {
+            func(*cell);
+          }
+        }
+      }
+    }
+  }
+
+  // Visits the occupied cells at Chebyshev distance exactly ring.
+  template <typename Func>
+  void forRing(CellCoord center, int ring, Func &func) const {
+    for (int x = -ring; x <= ring; x++) {
+      for (int y = -ring; y <= ring; y++) {
+        bool onFace = std::abs(x) == ring || std::abs(y) == ring;
+        int step = onFace || ring == 0 ? 1 : 2 * ring;
+        for (int z = -ring; z <= ring; z += step) {
+          if (const Cell *cell = find(center.x + x, center.y + y,
+                                      center.z + z)) {
+            func(*cell);
+          }
+        }
+      }
+    }
+  }
+
+  // Visits the occupied cells within reach of coord whose offset from it is
+  // lexicographically positive.
+  template <typename Func>
+  void forForwardNeighbours(CellCoord coord, int reach, Func func) const {
+    for (int x = 0; x <= reach; x++) {
+      for (int y = x == 0 ? 0 : -reach; y <= reach; y++) {
+        for (int z = x == 0 && y == 0 ? 1 : -reach; z <= reach; z++) {
+          if (const Cell *cell = find(coord.x + x, coord.y + y, coord.z + z)) {
+            func(*cell);
+          }
+        }
+      }
+    }
+  }
+
+  static void distancesTo(const Cell &cell, Vector3 point,
+                          std::vector<float> &distances) {
+    int cellCount = static_cast<int>(cell.entities.size());
+    distances.resize(cellCount);
+    streamKernels().distanceSquared(cell.x.data(), cell.y.data(),
+                                    cell.z.data(), point, distances.data(),
+                                    cellCount);
+  }
+
+  static void pairsInCell(const Cell &cell, float radiusSquared,
+                          std::vector<float> &distances,
+                          std::vector<std::pair<Entity, Entity>> &found) {
+    int cellCount = static_cast<int>(cell.entities.size());
+    for (int i = 0; i + 1 < cellCount; i++) {
+      int rest = cellCount - i - 1;
+      distances.resize(rest);
+      streamKernels().distanceSquared(
+          cell.x.data() + i + 1, cell.y.data() + i + 1, cell.z.data() + i + 1,
+          Vector3(cell.x[i], cell.y[i], cell.z[i]), distances.data(), rest);
+      for (int j = 0; j < rest; j++) {
+        if (distances[j] <= radiusSquared) {
+          found.emplace_back(cell.entities[i], cell.entities[i + 1 + j]);
+        }
+      }
+    }
+  }
+
+  // Points further than the radius from other's bounds are skipped before
+  // running the kernel, which prunes most of a neighbour cell when the
+  // radius is small against the cell size.
+  void pairsBetween(const Cell &cell, const Cell &other, float radiusSquared,
+                    std::vector<float> &distances,
+                    std::vector<std::pair<Entity, Entity>> &found) const {
+    float lowX, highX, lowY, highY, lowZ, highZ;
+    boundsOf(other.coord.x, lowX, highX);
+    boundsOf(other.coord.y, lowY, highY);
+    boundsOf(other.coord.z, lowZ, highZ);
+    for (std::size_t i = 0; i < cell.entities.size(); i++) {
+      float dx = std::max({lowX - cell.x[i], 0.0f, cell.x[i] - highX});
+      float dy = std::max({lowY - cell.y[i], 0.0f, cell.y[i] - highY});
+      float dz = std::max({lowZ - cell.z[i], 0.0f, cell.z[i] - highZ});
+      if (dx * dx + dy * dy + dz * dz > radiusSquared) {
+        continue;
+      }
+
+      distancesTo(other, Vector3(cell.x[i], cell.y[i], cell.z[i]), distances);
+      for (std::size_t j = 0; j < other.entities.size(); j++) {
+        if (distances[j] <= radiusSquared) {
+          found.emplace_back(cell.entities[i], other.entities[j]);
+        }
+      }
+    }
+  }
+};
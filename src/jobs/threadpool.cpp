@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counts the tasks submitted under it that have not finished yet.
+struct TaskGroup {
+  std::atomic<int> pending{0};
+};
+
+// Work-stealing pool: each worker pushes and pops its own queue from the back
+// and steals from the front of the others when it runs dry. Threads outside
+// the pool submit round-robin and help run tasks while they wait, so a pool
+// with zero workers still makes progress on the waiting thread.
+struct ThreadPool {
+  explicit ThreadPool(int workerCount = defaultWorkerCount()) {
+    int queueCount = std::max(workerCount, 1);
+    for (int i = 0; i < queueCount; i++) {
+      queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < workerCount; i++) {
+      workers.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // The calling thread helps out in wait(), so one core is left for it.
+  static int defaultWorkerCount() {
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(cores, 1) - 1;
+  }
+
+  int workerCount() const { return static_cast<int>(workers.size()); }
+
+  // Threads that can run tasks at the same time, including one waiter.
+  int concurrency() const { return workerCount() + 1; }
+
+  void submit(TaskGroup &group, std::function<void()> task) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    int self = currentWorker();
+    int queue = self != -1 ? self
+                           : static_cast<int>(nextQueue.fetch_add(1) %
+                                              queues.size());
+    {
+      std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+      queues[queue]->tasks.push_back(Task{std::move(task), &group});
+    }
+
+    queuedTasks.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeWorkers.notify_one();
+  }
+
+  void wait(TaskGroup &group) {
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+      if (!runOne(currentWorker())) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Index of the calling thread among this pool's workers, or -1.
+  int currentWorker() const {
+    return currentPool == this ? currentWorkerIndex : -1;
+  }
+
+private:
+  struct Task {
+    std::function<void()> function;
+    TaskGroup *group;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<int> queuedTasks{0};
+  std::atomic<unsigned> nextQueue{0};
+
+  std::mutex sleepMutex;
+  std::condition_variable wakeWorkers;
+  bool stopping = false;
+
+  static inline thread_local const ThreadPool *currentPool = nullptr;
+  static inline thread_local int currentWorkerIndex = -1;
+
+  void workerLoop(int index) {
+    currentPool = this;
+    currentWorkerIndex = index;
+
+    while (true) {
+      if (runOne(index)) {
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wakeWorkers.wait(lock, [this] { return stopping || queuedTasks > 0; });
+      if (stopping && queuedTasks == 0) {
+        return;
+      }
+    }
+  }
+
+  bool runOne(int self) {
+    Task task;
+    if (!pop(self, task)) {
+      return false;
+    }
+
+    task.function();
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(int self, Task &task) {
+    if (queuedTasks.load() == 0) {
+      return false;
+    }
+
+    int queueCount = static_cast<int>(queues.size());
+    if (self != -1) {
+      WorkerQueue &own = *queues[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        queuedTasks.fetch_sub(1);
+        return true;
+      }
+    }
+
+    int start = self != -1 ? self + 1 : 0;
+    for (int i = 0; i < queueCount; i++) {
+      WorkerQueue &victim = *queues[(start + i) % queueCount];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queuedTasks.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// Pool shared by the scheduler and parallel views, sized to the machine.
+inline ThreadPool &defaultThreadPool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+// Runs func(begin, end) over [0, count) split into chunks whose boundaries
+// are multiples of granularity, so chunks handed to different threads never
+// share a cache line when granularity elements span whole lines. Chunks are
+// sized for a few per thread so stealing can even out uneven work.
+template <typename Func>
+void parallelFor(ThreadPool &pool, int count, int granularity, Func func) {
+  const int minimumChunk = 1024;
+  int chunk = count / (pool.concurrency() * 4) + 1;
+  chunk = std::max(chunk, minimumChunk);
+  chunk = (chunk + granularity - 1) / granularity * granularity;
+
+  if (count <= chunk || pool.workerCount() == 0) {
+    func(0, count);
+    return;
+  }
+
+  TaskGroup group;
+  std::mutex errorMutex;
+  std::exception_ptr firstError;
+  for (int begin = 0; begin < count; begin += chunk) {
+    int end = std::min(begin + chunk, count);
+    pool.submit(group, [&, begin, end] {
+      try {
+        func(begin, end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!firstError) {
+          firstError = std::current_exception();
+        }
+      }
+    });
+  }
+  pool.wait(group);
+
+  if (firstError) {
+    std::rethrow_exception(firstError);
+  }
+}
@@ -1,13 +1,15 @@
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
-#define NOMINMAX
-
 #include "SDL3/SDL_log.h"
 #include <stdio.h>
 #include <string.h>
+#ifdef _WIN32
+#define NOMINMAX
 #include <windows.h>
+#endif
+#include "assets/assetloader.cpp"
 #include "components/health.cpp"
 #include "components/position.cpp"
+#include "components/renderable.cpp"
+#include "game/renderextract.cpp"
 #include "game/scene.cpp"
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_video.h>
@@ -20,13 +22,32 @@ const int MAX_FRAMES_IN_FLIGHT = 2;
 #include <optional>
 #include <set>
 #include <algorithm>
-#include <fstream>
 #include <limits>
 #include "backends/imgui_impl_vulkan.h"
 #include "backends/imgui_impl_sdl3.h"
 #include "imgui.h"
 #include "math/math.hpp"
+#include "profiler/profiler.cpp"
+#include "profiler/profileroverlay.cpp"
+#include "renderer/gpuallocator.cpp"
+#include "renderer/pipelinecache.cpp"
+#include "renderer/stagingring.cpp"
 #include <array>
+#include <chrono>
+#include <random>
+
+// Set by CMake to the source tree's shaders directory.
+#ifndef GROUNDWORK_SHADER_DIR
+#define GROUNDWORK_SHADER_DIR "shaders"
+#endif
+
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 8;
+const VkDeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
+// Relative to the working directory; rewritten on every clean shutdown.
+const char* const PIPELINE_CACHE_FILE = "groundwork_pipelines.cache";
+// Visible entities beyond this are dropped for the frame.
+const uint32_t MAX_INSTANCES_PER_FRAME = 1 << 17;
 
 
 struct Vertex {
@@ -48,26 +69,46 @@ struct Vertex {
         attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
         attributeDescriptions[0].offset = offsetof(Vertex, pos);
 
-    return attributeDescriptions;
-}
-};
-
-static std::vector<char> readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(Vertex, color);
 
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file");
+        return attributeDescriptions;
     }
+};
 
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+// Meshes are unit-sized, y up and wound clockwise as seen on screen;
+// instances scale and move them.
+const std::vector<Vertex> vertices = {
+    {{0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}},
+    {{1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
+    {{-1.0f, -1.0f}, {0.0f, 0.0f, 1.0f}},
+
+    {{-1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}},
+    {{1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}},
+    {{1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}},
+    {{1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}},
+    {{-1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}},
+    {{-1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}}
+};
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+// A range of vertices; Renderable::mesh indexes this table.
+struct Mesh {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+};
 
-    file.close();
-    return buffer;
-}
+const std::vector<Mesh> meshes = {
+    {0, 3}, // triangle
+    {3, 6}  // quad
+};
+
+// Push constants of shader.vert: maps world x/y to clip space.
+struct ViewConstants {
+    float centerX, centerY;
+    float scaleX, scaleY;
+};
 
 class VulkanEngine {
 private:
@@ -89,21 +130,100 @@ private:
   VkExtent2D swapChainExtent;
   std::vector<VkFramebuffer> swapChainFramebuffers;
 
-  SDL_Window* window;
+  SDL_Window* window = nullptr;
+
+  // Renders into offscreen images instead of a swapchain: no window,
+  // surface or present, so it runs on GPU-less machines with a software ICD
+  // such as lavapipe.
+  bool headless = false;
+  std::vector<GpuAllocation> offscreenMemory;
+  uint32_t nextOffscreenImage = 0;
 
   VkRenderPass renderPass;
   VkPipelineLayout pipelineLayout;
   VkPipeline graphicsPipeline;
 
+  // Pipelines compile on defaultThreadPool() workers against the shared
+  // cache while init() carries on; finishPipelines() joins them.
+  PipelineCache pipelineCache;
+  TaskGroup pipelineTasks;
+  std::mutex pipelineErrorMutex;
+  std::exception_ptr pipelineError;
+
+  // Requested before anything else in init(), so the files are mapped
+  // while the instance and device come up.
+  AssetLoader assets;
+  std::shared_future<AssetHandle> vertShader;
+  std::shared_future<AssetHandle> fragShader;
+
   VkCommandPool commandPool;
-  std::vector<VkCommandBuffer> commandBuffers;
 
-  std::vector<VkSemaphore> imageAvailableSemaphores;
-  std::vector<VkSemaphore> renderFinishedSemaphores;
-  std::vector<VkFence> inFlightFences;
+  // Every buffer and image draws its memory from here; uploads to
+  // device-local memory go through the staging ring.
+  GpuAllocator gpuAllocator;
+  StagingRing stagingRing;
+  VkBuffer vertexBuffer;
+  GpuAllocation vertexAllocation;
+  // Everything one frame's recording and submission touches. drawFrame
+  // rotates through framesInFlight of these, so the CPU records frame N+1
+  // while the GPU still works on frame N; a set is only reused after its
+  // fence says the GPU is done with it.
+  struct FrameResources {
+      VkCommandBuffer commandBuffer;
+      VkSemaphore imageAvailable;
+      VkSemaphore renderFinished;
+      VkFence inFlight;
+      // Persistently mapped; extraction writes this frame's instances here.
+      GpuArena instances;
+      VkDeviceSize instanceOffset = 0;
+  };
+
+  std::vector<FrameResources> frames;
+  uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+  uint32_t currentFrame = 0;
+
+  // Fence of the frame that last rendered to each swapchain image, for when
+  // there are fewer images than frames in flight.
+  std::vector<VkFence> imagesInFlight;
+
+  // The camera looks at (cameraX, cameraY) and shows cameraHalfHeight world
+  // units above and below it.
+  RenderExtractor extractor;
+  float cameraX = 0.0f;
+  float cameraY = 0.0f;
+  float cameraHalfHeight = 100.0f;
+
+  VkDescriptorPool imguiDescriptorPool;
 
   bool framebufferResized = false;
 
+  // CPU time spent in drawFrame's stages, summed since startup. A high
+  // fence wait means the GPU is the bottleneck at this depth; near zero with
+  // a deeper queue only adds latency.
+  struct FrameTimings {
+      uint64_t frames = 0;
+      double fenceWaitMs = 0;
+      double recordMs = 0;
+      double submitMs = 0;
+      double extractMs = 0;
+      double lastFenceWaitMs = 0;
+      double maxFenceWaitMs = 0;
+      uint32_t lastInstances = 0;
+      uint32_t lastDrawCalls = 0;
+  };
+  FrameTimings frameTimings;
+
+  // Where init() spent its time. pipelineMs sums the builds on the workers;
+  // pipelineWaitMs is the part init() still had to wait for.
+  struct StartupTimings {
+      double totalMs = 0;
+      double pipelineMs = 0;
+      double pipelineWaitMs = 0;
+      bool warmCache = false;
+      size_t cacheBytes = 0;
+  };
+  StartupTimings startupTimings;
+
   struct QueueFamilyIndices {
       std::optional<uint32_t> graphicsFamily;
       std::optional<uint32_t> presentFamily;
@@ -127,7 +247,13 @@ private:
           }
 
           VkBool32 presentSupport = false;
-          vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+          if (headless) {
+              // Nothing is presented; the graphics queue stands in.
+              presentSupport = (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+          }
+          else {
+              vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+          }
           if (presentSupport) {
               indices.presentFamily = i;
           }
@@ -138,6 +264,10 @@ private:
       return indices;
   }
 
+  static double elapsedMs(std::chrono::steady_clock::time_point start) {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
   struct SwapChainSupportDetails {
       VkSurfaceCapabilitiesKHR capabilities;
       std::vector<VkSurfaceFormatKHR> formats;
@@ -159,6 +289,15 @@ public:
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
+    if (headless) {
+      createInfo.enabledExtensionCount = 0;
+      createInfo.enabledLayerCount = 0;
+      if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance!");
+      }
+      return;
+    }
+
     // this part is about getting the vkinstance setup with info from SDL
     // windowing
     uint32_t count_instance_extensions;
@@ -197,6 +336,11 @@ public:
       vkGetPhysicalDeviceProperties(device, &deviceProperties);
       vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+      if (headless) {
+          // Software ICDs report VK_PHYSICAL_DEVICE_TYPE_CPU.
+          return indices.isComplete();
+      }
+
       return indices.isComplete() &&
           deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
           deviceFeatures.geometryShader;
@@ -253,9 +397,10 @@ public:
           queueCreateInfos.push_back(queueCreateInfo);
       }
 
-      const std::vector<const char*> deviceExtensions = {
-          VK_KHR_SWAPCHAIN_EXTENSION_NAME
-      };
+      std::vector<const char*> deviceExtensions;
+      if (!headless) {
+          deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+      }
 
       VkDeviceCreateInfo createInfo{};
       createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -386,6 +531,40 @@ public:
       swapChainExtent = extent;
   }
 
+  // Headless stand-in for setupSwapchain: imageCount color targets that
+  // drawFrame cycles through.
+  void createOffscreenTargets(VkExtent2D extent, uint32_t imageCount) {
+      swapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+      swapChainExtent = extent;
+      swapChainImages.resize(imageCount);
+      offscreenMemory.resize(imageCount);
+
+      for (uint32_t i = 0; i < imageCount; i++) {
+          VkImageCreateInfo imageInfo{};
+          imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+          imageInfo.imageType = VK_IMAGE_TYPE_2D;
+          imageInfo.format = swapChainImageFormat;
+          imageInfo.extent = { extent.width, extent.height, 1 };
+          imageInfo.mipLevels = 1;
+          imageInfo.arrayLayers = 1;
+          imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+          imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+          imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+          imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+          imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+          if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &swapChainImages[i]) != VK_SUCCESS) {
+              throw std::runtime_error("failed to create offscreen image!");
+          }
+
+          VkMemoryRequirements memRequirements;
+          vkGetImageMemoryRequirements(logicalDevice, swapChainImages[i], &memRequirements);
+
+          offscreenMemory[i] = gpuAllocator.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GpuResourceKind::Optimal);
+          vkBindImageMemory(logicalDevice, swapChainImages[i], offscreenMemory[i].memory, offscreenMemory[i].offset);
+      }
+  }
+
   void createImageViews() {
       swapChainImageViews.resize(swapChainImages.size());
       for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -410,11 +589,17 @@ public:
       }
   }
 
-  VkShaderModule createShaderModule(const std::vector<char>& code) {
+  // Hands the mapped SPIR-V straight to the driver; mappings are page
+  // aligned, so the words are too.
+  VkShaderModule createShaderModule(const AssetHandle& code) {
+      if (!code || code->size() % sizeof(uint32_t) != 0) {
+          throw std::runtime_error("failed to open shader " + (code ? code->path : std::string("file")));
+      }
+
       VkShaderModuleCreateInfo createInfo{};
       createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-      createInfo.codeSize = code.size();
-      createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+      createInfo.codeSize = code->size();
+      createInfo.pCode = reinterpret_cast<const uint32_t*>(code->data());
 
       VkShaderModule shaderModule;
       if (vkCreateShaderModule(logicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -424,9 +609,9 @@ public:
   }
 
   void createGraphicsPipeline() {
-      auto vertShaderCode = readFile("C:/Users/silve/Documents/Groundwork/shaders/vert.spv");
-      auto fragShaderCode = readFile("C:/Users/silve/Documents/Groundwork/shaders/frag.spv");
-      
+      AssetHandle vertShaderCode = vertShader.get();
+      AssetHandle fragShaderCode = fragShader.get();
+
       VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
       VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
@@ -458,12 +643,32 @@ public:
       VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
       vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-      auto bindingDescription = Vertex::getBindingDescription();
-      auto attributeDescriptions = Vertex::getAttributeDescriptions();
+      // Binding 0 steps per vertex through the mesh, binding 1 per instance
+      // through the frame's InstanceData.
+      VkVertexInputBindingDescription instanceBinding{};
+      instanceBinding.binding = 1;
+      instanceBinding.stride = sizeof(InstanceData);
+      instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+      std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+          Vertex::getBindingDescription(), instanceBinding
+      };
 
-      vertexInputInfo.vertexBindingDescriptionCount = 1;
+      auto vertexAttributes = Vertex::getAttributeDescriptions();
+      std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+      attributeDescriptions[0] = vertexAttributes[0];
+      attributeDescriptions[1] = vertexAttributes[1];
+      attributeDescriptions[2].binding = 1;
+      attributeDescriptions[2].location = 2;
+      attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+      attributeDescriptions[2].offset = offsetof(InstanceData, x);
+      attributeDescriptions[3].binding = 1;
+      attributeDescriptions[3].location = 3;
+      attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+      attributeDescriptions[3].offset = offsetof(InstanceData, r);
+
+      vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
       vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-      vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+      vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
       vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
       VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -497,8 +702,14 @@ public:
 
       VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
       pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+      VkPushConstantRange pushConstantRange{};
+      pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+      pushConstantRange.offset = 0;
+      pushConstantRange.size = sizeof(ViewConstants);
+
       pipelineLayoutInfo.setLayoutCount = 0;
-      pipelineLayoutInfo.pushConstantRangeCount = 0;
+      pipelineLayoutInfo.pushConstantRangeCount = 1;
+      pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
       if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
           throw std::runtime_error("failed to create pipeline layout!");
@@ -531,7 +742,7 @@ public:
       pipelineInfo.subpass = 0;
       pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-      if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+      if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache.handle(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
           throw std::runtime_error("failed to create graphics pipeline!");
       }
 
@@ -539,6 +750,47 @@ public:
       vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
   }
 
+  // Queues every pipeline build on the pool. They only need the device,
+  // the render pass and the cache, which is internally synchronized.
+  void startPipelines() {
+      pipelineError = nullptr;
+      submitPipeline([this] { createGraphicsPipeline(); });
+  }
+
+  void submitPipeline(std::function<void()> build) {
+      defaultThreadPool().submit(pipelineTasks, [this, build = std::move(build)] {
+          GW_PROFILE_SCOPE("buildPipeline");
+          auto start = std::chrono::steady_clock::now();
+          try {
+              build();
+          }
+          catch (...) {
+              std::lock_guard<std::mutex> lock(pipelineErrorMutex);
+              if (!pipelineError) {
+                  pipelineError = std::current_exception();
+              }
+          }
+          std::lock_guard<std::mutex> lock(pipelineErrorMutex);
+          startupTimings.pipelineMs += elapsedMs(start);
+      });
+  }
+
+  // Blocks until the pipelines exist, rethrowing the first build failure.
+  void finishPipelines() {
+      GW_PROFILE_FUNCTION();
+      auto waitStart = std::chrono::steady_clock::now();
+      defaultThreadPool().wait(pipelineTasks);
+      startupTimings.pipelineWaitMs = elapsedMs(waitStart);
+
+      // The modules are built; let the SPIR-V mappings go.
+      vertShader = {};
+      fragShader = {};
+      assets.trim();
+      if (pipelineError) {
+          std::rethrow_exception(pipelineError);
+      }
+  }
+
   void createRenderPass() {
       VkAttachmentDescription colorAttachment{};
       colorAttachment.format = swapChainImageFormat;
@@ -548,7 +800,7 @@ public:
       colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
       colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
       colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+      colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
       VkAttachmentReference colorAttachmentRef{};
       colorAttachmentRef.attachment = 0;
@@ -582,29 +834,44 @@ public:
   }
 
   void cleanup() {
+      vkDeviceWaitIdle(logicalDevice);
+      if (!headless) {
+          ImGui_ImplVulkan_Shutdown();
+          ImGui_ImplSDL3_Shutdown();
+          ImGui::DestroyContext();
+          vkDestroyDescriptorPool(logicalDevice, imguiDescriptorPool, nullptr);
+      }
+
+      gpuAllocator.destroyBuffer(vertexBuffer, vertexAllocation);
+      stagingRing.destroy(gpuAllocator);
+      for (FrameResources& frame : frames) {
+          frame.instances.destroy(gpuAllocator);
+      }
+
       cleanupSwapChain();
       vkDestroyPipeline(logicalDevice, graphicsPipeline, nullptr);
       vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
       vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
 
-      for (auto imageView : swapChainImageViews) {
-          vkDestroyImageView(logicalDevice, imageView, nullptr);
-      }
+      vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
 
-      for (auto framebuffer : swapChainFramebuffers) {
-          vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+      if (!pipelineCache.save()) {
+          std::cerr << "failed to save " << PIPELINE_CACHE_FILE << std::endl;
       }
+      pipelineCache.destroy();
 
-      vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
-
-      for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-          vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], nullptr);
-          vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
-          vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
+      for (FrameResources& frame : frames) {
+          vkDestroySemaphore(logicalDevice, frame.renderFinished, nullptr);
+          vkDestroySemaphore(logicalDevice, frame.imageAvailable, nullptr);
+          vkDestroyFence(logicalDevice, frame.inFlight, nullptr);
       }
 
-      vkDestroySwapchainKHR(logicalDevice, swapchain, nullptr);
+      gpuAllocator.destroy();
       vkDestroyDevice(logicalDevice, nullptr);
+      if (!headless) {
+          vkDestroySurfaceKHR(instance, surface, nullptr);
+      }
+      vkDestroyInstance(instance, nullptr);
   }
 
   void createFramebuffers() {
@@ -650,7 +917,8 @@ public:
   }
 
   void createCommandBuffer() {
-      commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+      frames.resize(framesInFlight);
+      std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
 
       VkCommandBufferAllocateInfo allocInfo{};
       allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -661,9 +929,16 @@ public:
       if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
           throw std::runtime_error("failed to allocate command buffers!");
       }
+
+      for (uint32_t i = 0; i < framesInFlight; i++) {
+          frames[i].commandBuffer = commandBuffers[i];
+      }
   }
 
-  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+  void recordCommandBuffer(FrameResources& frame, uint32_t imageIndex) {
+      GW_PROFILE_FUNCTION();
+      VkCommandBuffer commandBuffer = frame.commandBuffer;
+
       VkCommandBufferBeginInfo beginInfo{};
       beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
       beginInfo.flags = 0;
@@ -673,6 +948,9 @@ public:
           throw std::runtime_error("failed to begin recording command buffer!");
       }
 
+      // Copies have to land before the render pass reads them.
+      stagingRing.record(commandBuffer, currentFrame);
+
       VkRenderPassBeginInfo renderPassInfo{};
       renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
       renderPassInfo.renderPass = renderPass;
@@ -700,7 +978,32 @@ public:
       scissor.offset = { 0, 0 };
       scissor.extent = swapChainExtent;
       vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-      vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+      ViewConstants viewConstants = viewConstantsFor(swapChainExtent);
+      vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+          sizeof(ViewConstants), &viewConstants);
+
+      VkBuffer vertexBuffers[] = { vertexBuffer, frame.instances.buffer };
+      VkDeviceSize offsets[] = { 0, frame.instanceOffset };
+      vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+
+      // The extractor grouped instances by mesh, so every mesh is one draw
+      // however many entities use it.
+      uint32_t drawCalls = 0;
+      for (const MeshBatch& batch : extractor.batches()) {
+          if (batch.mesh >= meshes.size()) {
+              continue;
+          }
+          const Mesh& mesh = meshes[batch.mesh];
+          vkCmdDraw(commandBuffer, mesh.vertexCount, batch.instanceCount, mesh.firstVertex, batch.firstInstance);
+          drawCalls++;
+      }
+      frameTimings.lastDrawCalls = drawCalls;
+
+      ImDrawData* drawData = headless ? nullptr : ImGui::GetDrawData();
+      if (drawData != nullptr) {
+          ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
+      }
 
       vkCmdEndRenderPass(commandBuffer);
 
@@ -709,10 +1012,58 @@ public:
       }
   }
 
+  void createVertexBuffer() {
+      stagingRing.init(gpuAllocator, STAGING_RING_SIZE, framesInFlight);
+
+      VkDeviceSize size = sizeof(vertices[0]) * vertices.size();
+      vertexBuffer = gpuAllocator.createBuffer(size,
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexAllocation);
+
+      if (!stagingRing.upload(vertexBuffer, 0, vertices.data(), size)) {
+          throw std::runtime_error("vertex data doesn't fit the staging ring!");
+      }
+  }
+
+  void createInstanceBuffers() {
+      for (FrameResources& frame : frames) {
+          frame.instances.init(gpuAllocator, MAX_INSTANCES_PER_FRAME * sizeof(InstanceData),
+              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+      }
+  }
+
+  // Copies the visible entities of registry into frame's instance buffer.
+  // The frame's fence must have signaled.
+  void extractInstances(FrameResources& frame, Registry& registry) {
+      auto extractStart = std::chrono::steady_clock::now();
+      frame.instances.reset();
+
+      uint32_t count = std::min(extractor.gather(registry, currentView()), MAX_INSTANCES_PER_FRAME);
+      SubAllocation range = frame.instances.allocate(count * sizeof(InstanceData));
+      extractor.write(registry, static_cast<InstanceData*>(frame.instances.pointer(range)), count);
+      frame.instanceOffset = range.offset;
+
+      frameTimings.lastInstances = count;
+      frameTimings.extractMs += elapsedMs(extractStart);
+  }
+
+  // World rectangle the camera shows, widened to the target's aspect ratio.
+  RenderView currentView() const {
+      float aspect = static_cast<float>(swapChainExtent.width) / std::max(swapChainExtent.height, 1u);
+      float halfWidth = cameraHalfHeight * aspect;
+      return { cameraX - halfWidth, cameraY - cameraHalfHeight, cameraX + halfWidth, cameraY + cameraHalfHeight };
+  }
+
+  // Clip space has y pointing down, the world has it pointing up.
+  ViewConstants viewConstantsFor(VkExtent2D extent) const {
+      float aspect = static_cast<float>(extent.width) / std::max(extent.height, 1u);
+      return { cameraX, cameraY, 1.0f / (cameraHalfHeight * aspect), -1.0f / cameraHalfHeight };
+  }
+
   void createSyncObjects() {
-      imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-      renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-      inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+      frames.resize(framesInFlight);
+      imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
 
       VkSemaphoreCreateInfo semaphoreInfo{};
       semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -721,30 +1072,43 @@ public:
       fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
       fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-      for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-          if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-              vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-              vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+      for (FrameResources& frame : frames) {
+          if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.imageAvailable) != VK_SUCCESS ||
+              vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.renderFinished) != VK_SUCCESS ||
+              vkCreateFence(logicalDevice, &fenceInfo, nullptr, &frame.inFlight) != VK_SUCCESS) {
 
               throw std::runtime_error("failed to create synchronization objects for a frame!");
           }
       }
   }
 
-  void drawFrame() {
-      uint32_t currentFrame = 0;
+  void drawFrame(Registry& registry) {
+      GW_PROFILE_FUNCTION();
+      FrameResources& frame = frames[currentFrame];
 
-      vkWaitForFences(logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-      vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
+      auto fenceStart = std::chrono::steady_clock::now();
+      {
+          GW_PROFILE_SCOPE("waitForFence");
+          vkWaitForFences(logicalDevice, 1, &frame.inFlight, VK_TRUE, UINT64_MAX);
+      }
+      recordFenceWait(elapsedMs(fenceStart));
+      stagingRing.retire(currentFrame);
 
       uint32_t imageIndex;
-      VkResult result = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX,
-          imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-      if (result != VK_SUCCESS) {
-          throw std::runtime_error("failed to acquire swap chain image!");
+      VkResult result = VK_SUCCESS;
+      if (headless) {
+          imageIndex = nextOffscreenImage;
+          nextOffscreenImage = (nextOffscreenImage + 1) % swapChainImages.size();
       }
-      else if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+      else {
+          GW_PROFILE_SCOPE("vkAcquireNextImageKHR");
+          result = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX,
+              frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+      }
+
+      // The fence is still signaled here, so returning early can't leave
+      // the next wait on this frame hanging.
+      if (result == VK_ERROR_OUT_OF_DATE_KHR) {
           recreateSwapChain();
           return;
       }
@@ -756,29 +1120,55 @@ public:
           throw std::runtime_error("swap chain image index out of range!");
       }
 
-      vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
+      // With fewer swapchain images than frames in flight, an older frame
+      // may still be rendering into this image.
+      if (imagesInFlight[imageIndex] != VK_NULL_HANDLE && imagesInFlight[imageIndex] != frame.inFlight) {
+          auto imageWaitStart = std::chrono::steady_clock::now();
+          vkWaitForFences(logicalDevice, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+          double waited = elapsedMs(imageWaitStart);
+          frameTimings.fenceWaitMs += waited;
+          frameTimings.lastFenceWaitMs += waited;
+      }
+      imagesInFlight[imageIndex] = frame.inFlight;
+
+      vkResetFences(logicalDevice, 1, &frame.inFlight);
 
+      extractInstances(frame, registry);
 
-      vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-      recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+      auto recordStart = std::chrono::steady_clock::now();
+      vkResetCommandBuffer(frame.commandBuffer, 0);
+      recordCommandBuffer(frame, imageIndex);
+      frameTimings.recordMs += elapsedMs(recordStart);
 
       VkSubmitInfo submitInfo{};
       submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-      VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
+      VkSemaphore waitSemaphores[] = { frame.imageAvailable };
       VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-      submitInfo.waitSemaphoreCount = 1;
+      submitInfo.waitSemaphoreCount = headless ? 0 : 1;
       submitInfo.pWaitSemaphores = waitSemaphores;
       submitInfo.pWaitDstStageMask = waitStages;
       submitInfo.commandBufferCount = 1;
-      submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+      submitInfo.pCommandBuffers = &frame.commandBuffer;
 
-      VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame]};
-      submitInfo.signalSemaphoreCount = 1;
+      VkSemaphore signalSemaphores[] = { frame.renderFinished };
+      submitInfo.signalSemaphoreCount = headless ? 0 : 1;
       submitInfo.pSignalSemaphores = signalSemaphores;
 
-      if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-          throw std::runtime_error("failed to submit draw command buffer!");
+      auto submitStart = std::chrono::steady_clock::now();
+      {
+          GW_PROFILE_SCOPE("vkQueueSubmit");
+          if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlight) != VK_SUCCESS) {
+              throw std::runtime_error("failed to submit draw command buffer!");
+          }
+      }
+      frameTimings.submitMs += elapsedMs(submitStart);
+      frameTimings.frames++;
+
+      currentFrame = (currentFrame + 1) % framesInFlight;
+
+      if (headless) {
+          return;
       }
 
       VkPresentInfoKHR presentInfo{};
@@ -792,19 +1182,34 @@ public:
       presentInfo.pSwapchains = swapChains;
       presentInfo.pImageIndices = &imageIndex;
 
-      
-      result = vkQueuePresentKHR(presentQueue, &presentInfo);
+      {
+          GW_PROFILE_SCOPE("vkQueuePresentKHR");
+          result = vkQueuePresentKHR(presentQueue, &presentInfo);
+      }
 
-      if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+      // A resize is only acted on here, after the acquired image went out,
+      // so its imageAvailable semaphore never stays signaled.
+      if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+          framebufferResized) {
+          framebufferResized = false;
           recreateSwapChain();
       }
       else if (result != VK_SUCCESS) {
           throw std::runtime_error("failed to present swap chain image!");
       }
+  }
 
-      currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  void recordFenceWait(double milliseconds) {
+      frameTimings.fenceWaitMs += milliseconds;
+      frameTimings.lastFenceWaitMs = milliseconds;
+      frameTimings.maxFenceWaitMs = std::max(frameTimings.maxFenceWaitMs, milliseconds);
   }
 
+  const FrameTimings& timings() const { return frameTimings; }
+  const StartupTimings& startup() const { return startupTimings; }
+
+  uint32_t frameDepth() const { return framesInFlight; }
+
   void cleanupSwapChain() {
       for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
           vkDestroyFramebuffer(logicalDevice, swapChainFramebuffers[i], nullptr);
@@ -814,10 +1219,24 @@ public:
           vkDestroyImageView(logicalDevice, swapChainImageViews[i], nullptr);
       }
 
+      if (headless) {
+          for (size_t i = 0; i < swapChainImages.size(); i++) {
+              vkDestroyImage(logicalDevice, swapChainImages[i], nullptr);
+              gpuAllocator.free(offscreenMemory[i]);
+          }
+          return;
+      }
+
       vkDestroySwapchainKHR(logicalDevice, swapchain, nullptr);
   }
 
+  // The swapchain is rebuilt after the next present.
+  void onFramebufferResized() {
+      framebufferResized = true;
+  }
+
   void recreateSwapChain() {
+      GW_PROFILE_FUNCTION();
       vkDeviceWaitIdle(logicalDevice);
 
       cleanupSwapChain();
@@ -825,9 +1244,15 @@ public:
       setupSwapchain();
       createImageViews();
       createFramebuffers();
+      imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
   }
 
-  void init(SDL_Window* window) {
+  // frameDepth is how many frames the CPU may run ahead of the GPU, between
+  // 1 and MAX_FRAMES_IN_FLIGHT.
+  void init(SDL_Window* window, uint32_t frameDepth = DEFAULT_FRAMES_IN_FLIGHT) {
+      auto startupStart = std::chrono::steady_clock::now();
+      requestAssets();
+      framesInFlight = std::clamp(frameDepth, 1u, MAX_FRAMES_IN_FLIGHT);
       createInstance();
       if (!SDL_Vulkan_CreateSurface(window, instance, nullptr, &surface)) {
           throw std::runtime_error("failed to create surface");
@@ -837,13 +1262,17 @@ public:
 
       getPhysicalDevice();
       createLogicalDevice();
+      loadPipelineCache();
+      gpuAllocator.init(pChosenDevice, logicalDevice);
       setupSwapchain();
       createImageViews();
       createRenderPass();
-      createGraphicsPipeline();
+      startPipelines();
       createFramebuffers();
       createCommandPool();
       createCommandBuffer();
+      createVertexBuffer();
+      createInstanceBuffers();
       createSyncObjects();
 
       ImGui::CreateContext();
@@ -852,9 +1281,115 @@ public:
       io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
   
       ImGui_ImplSDL3_InitForVulkan(window);
+      createImGuiBackend();
+      finishPipelines();
+      startupTimings.totalMs = elapsedMs(startupStart);
+  }
+
+  void initHeadless(VkExtent2D extent, uint32_t frameDepth = DEFAULT_FRAMES_IN_FLIGHT, uint32_t imageCount = 3) {
+      auto startupStart = std::chrono::steady_clock::now();
+      requestAssets();
+      headless = true;
+      framesInFlight = std::clamp(frameDepth, 1u, MAX_FRAMES_IN_FLIGHT);
+
+      createInstance();
+      getPhysicalDevice();
+      createLogicalDevice();
+      loadPipelineCache();
+      gpuAllocator.init(pChosenDevice, logicalDevice);
+      createOffscreenTargets(extent, imageCount);
+      createImageViews();
+      createRenderPass();
+      startPipelines();
+      createFramebuffers();
+      createCommandPool();
+      createCommandBuffer();
+      createVertexBuffer();
+      createInstanceBuffers();
+      createSyncObjects();
+      finishPipelines();
+      startupTimings.totalMs = elapsedMs(startupStart);
+  }
+
+  void requestAssets() {
+      vertShader = assets.load(GROUNDWORK_SHADER_DIR "/vert.spv", AssetPriority::High);
+      fragShader = assets.load(GROUNDWORK_SHADER_DIR "/frag.spv", AssetPriority::High);
+  }
+
+  void loadPipelineCache() {
+      startupTimings.warmCache = pipelineCache.load(pChosenDevice, logicalDevice, PIPELINE_CACHE_FILE);
+      startupTimings.cacheBytes = pipelineCache.bytesLoaded();
+  }
+
+  // Draws frameCount frames as fast as the device allows and prints where
+  // the CPU time went, for automated renderer benchmarks.
+  void runHeadless(int frameCount, Registry& registry) {
+      std::cout << "device: " << deviceProperties.deviceName << ", "
+                << swapChainExtent.width << "x" << swapChainExtent.height << ", "
+                << framesInFlight << " frames in flight" << std::endl;
+      printf("startup:    %.1f ms, pipelines %.1f ms (%.1f ms waited), %s cache (%zu bytes)\n",
+             startupTimings.totalMs, startupTimings.pipelineMs, startupTimings.pipelineWaitMs,
+             startupTimings.warmCache ? "warm" : "cold", startupTimings.cacheBytes);
+
+      frameTimings = FrameTimings{};
+      auto start = std::chrono::steady_clock::now();
+      for (int frame = 0; frame < frameCount; frame++) {
+          drawFrame(registry);
+          profiler().endFrame();
+      }
+      vkDeviceWaitIdle(logicalDevice);
+      double totalMs = elapsedMs(start);
+
+      double frames = static_cast<double>(frameTimings.frames);
+      printf("frames:     %llu in %.1f ms\n", static_cast<unsigned long long>(frameTimings.frames), totalMs);
+      printf("extract:    %.3f ms/frame\n", frameTimings.extractMs / frames);
+      printf("record:     %.3f ms/frame\n", frameTimings.recordMs / frames);
+      printf("submit:     %.3f ms/frame\n", frameTimings.submitMs / frames);
+      printf("fence wait: %.3f ms/frame (max %.3f ms)\n", frameTimings.fenceWaitMs / frames, frameTimings.maxFenceWaitMs);
+      printf("throughput: %.1f frames/s\n", frames * 1000.0 / totalMs);
+      printf("instances:  %u in %u draw calls\n", frameTimings.lastInstances, frameTimings.lastDrawCalls);
+      printf("memory:     %d device allocations, %.1f MiB reserved\n", gpuAllocator.blockCount(),
+             gpuAllocator.reservedBytes() / (1024.0 * 1024.0));
+  }
+
+  void createImGuiBackend() {
+      VkDescriptorPoolSize poolSize{};
+      poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      poolSize.descriptorCount = 16;
+
+      VkDescriptorPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+      poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+      poolInfo.maxSets = 16;
+      poolInfo.poolSizeCount = 1;
+      poolInfo.pPoolSizes = &poolSize;
+
+      if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &imguiDescriptorPool) != VK_SUCCESS) {
+          throw std::runtime_error("failed to create imgui descriptor pool!");
+      }
+
+      uint32_t imageCount = std::max<uint32_t>(2, static_cast<uint32_t>(swapChainImages.size()));
+
+      ImGui_ImplVulkan_InitInfo initInfo{};
+      initInfo.Instance = instance;
+      initInfo.PhysicalDevice = pChosenDevice;
+      initInfo.Device = logicalDevice;
+      initInfo.QueueFamily = findQueueFamilies(pChosenDevice).graphicsFamily.value();
+      initInfo.Queue = graphicsQueue;
+      initInfo.DescriptorPool = imguiDescriptorPool;
+      initInfo.RenderPass = renderPass;
+      initInfo.MinImageCount = imageCount;
+      initInfo.ImageCount = imageCount;
+      initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+      initInfo.PipelineCache = pipelineCache.handle();
+
+      if (!ImGui_ImplVulkan_Init(&initInfo)) {
+          throw std::runtime_error("failed to initialize imgui vulkan backend!");
+      }
   }
 };
 
+#ifdef _WIN32
 void createConsole() {
   // SDL defines some overridden SDL_Main macro, so this is so I can do quick debugging with std::cout
   AllocConsole();
@@ -862,29 +1397,73 @@ void createConsole() {
   freopen("CONOUT$", "w", stdout);
   freopen("CONOUT$", "w", stderr);
 }
+#endif
 
+// Scatters count entities with a Position and a Renderable over the
+// default camera's view, alternating between the meshes.
+void spawnRenderables(Registry& registry, int count) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> coordinate(-150.0f, 150.0f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for (int i = 0; i < count; i++) {
+      Entity entity = registry.create();
+      registry.addComponent(entity, Position(coordinate(rng), coordinate(rng) * 0.66f, 0.0f));
+      registry.addComponent(entity, Renderable(static_cast<uint32_t>(i % meshes.size()), 0.3f + unit(rng),
+          unit(rng), unit(rng), unit(rng)));
+  }
+}
 
 
-
-const std::vector<Vertex> vertices = {
-    {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
-};
-
 int main(int argc, char * argv[]) {
 
   //if (strcmp(argv[1], "--debug") == 0) {
   //     createConsole();
   // }
- 
-  /*Scene active_scene = Scene{};*/
+
+  // --headless N renders N offscreen frames and prints timings instead of
+  // opening a window; --size WxH sets the target size. --frames-in-flight N
+  // sets how far the CPU may run ahead of the GPU. --entities N spawns N
+  // renderable entities.
+  int headlessFrames = 0;
+  int entityCount = 10000;
+  VkExtent2D headlessExtent = { 1280, 720 };
+  uint32_t frameDepth = DEFAULT_FRAMES_IN_FLIGHT;
+  for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+          headlessFrames = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+          sscanf(argv[++i], "%ux%u", &headlessExtent.width, &headlessExtent.height);
+      }
+      else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+          frameDepth = static_cast<uint32_t>(atoi(argv[++i]));
+      }
+      else if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc) {
+          entityCount = atoi(argv[++i]);
+      }
+  }
+
+  profiler().nameThread("main");
+
+  Scene active_scene;
+  spawnRenderables(active_scene.registry, entityCount);
+
+  if (headlessFrames > 0) {
+      VulkanEngine headlessEngine;
+      headlessEngine.initHeadless(headlessExtent, frameDepth);
+      headlessEngine.runHeadless(headlessFrames, active_scene.registry);
+      headlessEngine.cleanup();
+      return 0;
+  }
+
   /**/
-  /*active_scene.registry.addComponent(1, Position(5, 20, 4));*/
-  /*active_scene.registry.addComponent(1, Health(100));*/
+  /*Entity player = active_scene.registry.create();*/
+  /*active_scene.registry.addComponent(player, Position(5, 20, 4));*/
+  /*active_scene.registry.addComponent(player, Health(100));*/
   /**/
-  /*active_scene.registry.addComponent(9, Position(100, 200, 2));*/
-  /*active_scene.registry.addComponent(9, Health(25));*/
+  /*Entity enemy = active_scene.registry.create();*/
+  /*active_scene.registry.addComponent(enemy, Position(100, 200, 2));*/
+  /*active_scene.registry.addComponent(enemy, Health(25));*/
 
   VulkanEngine vulkanEngine;
 
@@ -895,15 +1474,41 @@ int main(int argc, char * argv[]) {
       throw std::runtime_error(SDL_GetError());
   }
 
-  vulkanEngine.init(window);
+  vulkanEngine.init(window, frameDepth);
 
   SDL_Event e;
   bool window_open = true;
   while (window_open) {
-      vulkanEngine.drawFrame();
+      active_scene.update();
+
+      ImGui_ImplVulkan_NewFrame();
+      ImGui_ImplSDL3_NewFrame();
+      ImGui::NewFrame();
+      drawProfilerOverlay(profiler());
+      if (ImGui::Begin("Renderer")) {
+          const auto& timings = vulkanEngine.timings();
+          const auto& startup = vulkanEngine.startup();
+          ImGui::Text("startup: %.1f ms, %s pipeline cache", startup.totalMs, startup.warmCache ? "warm" : "cold");
+          ImGui::Text("frames in flight: %u", vulkanEngine.frameDepth());
+          ImGui::Text("fence wait: %.3f ms (max %.3f ms)", timings.lastFenceWaitMs, timings.maxFenceWaitMs);
+          ImGui::Text("instances: %u in %u draw calls", timings.lastInstances, timings.lastDrawCalls);
+      }
+      ImGui::End();
+      ImGui::Render();
+
+      vulkanEngine.drawFrame(active_scene.registry);
+      profiler().endFrame();
+
       while (SDL_PollEvent(&e) != 0) {
+          ImGui_ImplSDL3_ProcessEvent(&e);
           if (e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
-              vulkanEngine.recreateSwapChain();
+              vulkanEngine.onFramebufferResized();
+          }
+          else if (e.type == SDL_EVENT_KEY_DOWN && e.key.key == SDLK_F12) {
+              // Open in chrome://tracing or ui.perfetto.dev.
+              if (profiler().writeChromeTrace("groundwork_trace.json")) {
+                  std::cout << "wrote groundwork_trace.json" << std::endl;
+              }
           }
         //   else if (e.type = SDL_EVENT_QUIT) {
         //       std::cout << "quit event requested" << std::endl;
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "math.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||           \
+    defined(_M_IX86)
+#define GW_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define GW_SIMD_X86 0
+#endif
+
+// SSE is part of the x86-64 baseline but optional on 32-bit builds.
+#if GW_SIMD_X86 && (defined(__SSE__) || defined(_M_X64) ||                   \
+                    (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define GW_SIMD_SSE 1
+#else
+#define GW_SIMD_SSE 0
+#endif
+
+// MSVC allows AVX2 intrinsics in any function; GCC and Clang need the
+// function itself compiled for AVX2. FMA is left out on purpose: fused
+// results round differently, and every kernel version has to produce the
+// same bits as the scalar one whatever CPU runs it.
+#if GW_SIMD_X86 && !defined(_MSC_VER)
+#define GW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GW_TARGET_AVX2
+#endif
+
+// Batch kernels over x/y/z float streams such as the SoA storage of Position
+// and Velocity. Every kernel has a scalar, an SSE and an AVX2 version; the
+// widest one the CPU supports is picked once at first use.
+struct StreamKernels {
+  // x += vx * dt, likewise for y and z.
+  void (*integrate)(float *x, float *y, float *z, const float *vx,
+                    const float *vy, const float *vz, float dt, int count);
+
+  // inside[i] = 1 if point i is within [min, max] on every axis, else 0.
+  // Returns how many points are inside.
+  int (*inBounds)(const float *x, const float *y, const float *z,
+                  Vector3 min, Vector3 max, uint8_t *inside, int count);
+
+  // out[i] = squared distance from point i to point.
+  void (*distanceSquared)(const float *x, const float *y, const float *z,
+                          Vector3 point, float *out, int count);
+
+  const char *name;
+};
+
+inline void integrateScalar(float *x, float *y, float *z, const float *vx,
+                            const float *vy, const float *vz, float dt,
+                            int count) {
+  for (int i = 0; i < count; i++) {
+    x[i] += vx[i] * dt;
+    y[i] += vy[i] * dt;
+    z[i] += vz[i] * dt;
+  }
+}
+
+inline int inBoundsScalar(const float *x, const float *y, const float *z,
+                          Vector3 min, Vector3 max, uint8_t *inside,
+                          int count) {
+  int total = 0;
+  for (int i = 0; i < count; i++) {
+    bool in = x[i] >= min.x && x[i] <= max.x && y[i] >= min.y &&
+              y[i] <= max.y && z[i] >= min.z && z[i] <= max.z;
+    inside[i] = in ? 1 : 0;
+    total += inside[i];
+  }
+  return total;
+}
+
+inline void distanceSquaredScalar(const float *x, const float *y,
+                                  const float *z, Vector3 point, float *out,
+                                  int count) {
+  for (int i = 0; i < count; i++) {
+    float dx = x[i] - point.x;
+    float dy = y[i] - point.y;
+    float dz = z[i] - point.z;
+    out[i] = dx * dx + dy * dy + dz * dz;
+  }
+}
+
+#if GW_SIMD_SSE
+
+inline void integrateSSE(float *x, float *y, float *z, const float *vx,
+                         const float *vy, const float *vz, float dt,
+                         int count) {
+  __m128 step = _mm_set1_ps(dt);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i),
+                                    _mm_mul_ps(_mm_loadu_ps(vx + i), step)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(_mm_loadu_ps(vy + i), step)));
+    _mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i),
+                                    _mm_mul_ps(_mm_loadu_ps(vz + i), step)));
+  }
+  integrateScalar(x + i, y + i, z + i, vx + i, vy + i, vz + i, dt, count - i);
+}
+
+inline int inBoundsSSE(const float *x, const float *y, const float *z,
+                       Vector3 min, Vector3 max, uint8_t *inside, int count) {
+  __m128 minX = _mm_set1_ps(min.x), maxX = _mm_set1_ps(max.x);
+  __m128 minY = _mm_set1_ps(min.y), maxY = _mm_set1_ps(max.y);
+  __m128 minZ = _mm_set1_ps(min.z), maxZ = _mm_set1_ps(max.z);
+  int total = 0;
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 px = _mm_loadu_ps(x + i);
+    __m128 py = _mm_loadu_ps(y + i);
+    __m128 pz = _mm_loadu_ps(z + i);
+    __m128 in = _mm_and_ps(_mm_cmpge_ps(px, minX), _mm_cmple_ps(px, maxX));
+    in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(py, minY),
+                                   _mm_cmple_ps(py, maxY)));
+    in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(pz, minZ),
+                                   _mm_cmple_ps(pz, maxZ)));
+    int mask = _mm_movemask_ps(in);
+    for (int lane = 0; lane < 4; lane++) {
+      inside[i + lane] = (mask >> lane) & 1;
+      total += inside[i + lane];
+    }
+  }
+  return total + inBoundsScalar(x + i, y + i, z + i, min, max, inside + i,
+                                count - i);
+}
+
+inline void distanceSquaredSSE(const float *x, const float *y, const float *z,
+                               Vector3 point, float *out, int count) {
+  __m128 pointX = _mm_set1_ps(point.x);
+  __m128 pointY = _mm_set1_ps(point.y);
+  __m128 pointZ = _mm_set1_ps(point.z);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), pointX);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), pointY);
+    __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), pointZ);
+    __m128 sum = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    _mm_storeu_ps(out + i, _mm_add_ps(sum, _mm_mul_ps(dz, dz)));
+  }
+  distanceSquaredScalar(x + i, y + i, z + i, point, out + i, count - i);
+}
+
+#endif
+
+#if GW_SIMD_X86
+
+GW_TARGET_AVX2 inline void integrateAVX2(float *x, float *y, float *z,
+                                         const float *vx, const float *vy,
+                                         const float *vz, float dt,
+                                         int count) {
+  __m256 step = _mm256_set1_ps(dt);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 dx = _mm256_mul_ps(_mm256_loadu_ps(vx + i), step);
+    _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), dx));
+    __m256 dy = _mm256_mul_ps(_mm256_loadu_ps(vy + i), step);
+    _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), dy));
+    __m256 dz = _mm256_mul_ps(_mm256_loadu_ps(vz + i), step);
+    _mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_loadu_ps(z + i), dz));
+  }
+  integrateScalar(x + i, y + i, z + i, vx + i, vy + i, vz + i, dt, count - i);
+}
+
+GW_TARGET_AVX2 inline int inBoundsAVX2(const float *x, const float *y,
+                                       const float *z, Vector3 min,
+                                       Vector3 max, uint8_t *inside,
+                                       int count) {
+  __m256 minX = _mm256_set1_ps(min.x), maxX = _mm256_set1_ps(max.x);
+  __m256 minY = _mm256_set1_ps(min.y), maxY = _mm256_set1_ps(max.y);
+  __m256 minZ = _mm256_set1_ps(min.z), maxZ = _mm256_set1_ps(max.z);
+  int total = 0;
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 px = _mm256_loadu_ps(x + i);
+    __m256 py = _mm256_loadu_ps(y + i);
+    __m256 pz = _mm256_loadu_ps(z + i);
+    __m256 in = _mm256_and_ps(_mm256_cmp_ps(px, minX, _CMP_GE_OQ),
+                              _mm256_cmp_ps(px, maxX, _CMP_LE_OQ));
+    in = _mm256_and_ps(in, _mm256_and_ps(_mm256_cmp_ps(py, minY, _CMP_GE_OQ),
+                                         _mm256_cmp_ps(py, maxY, _CMP_LE_OQ)));
+    in = _mm256_and_ps(in, _mm256_and_ps(_mm256_cmp_ps(pz, minZ, _CMP_GE_OQ),
+                                         _mm256_cmp_ps(pz, maxZ, _CMP_LE_OQ)));
+    int mask = _mm256_movemask_ps(in);
+    for (int lane = 0; lane < 8; lane++) {
+      inside[i + lane] = (mask >> lane) & 1;
+      total += inside[i + lane];
+    }
+  }
+  return total + inBoundsScalar(x + i, y + i, z + i, min, max, inside + i,
+                                count - i);
+}
+
+GW_TARGET_AVX2 inline void distanceSquaredAVX2(const float *x, const float *y,
+                                               const float *z, Vector3 point,
+                                               float *out, int count) {
+  __m256 pointX = _mm256_set1_ps(point.x);
+  __m256 pointY = _mm256_set1_ps(point.y);
+  __m256 pointZ = _mm256_set1_ps(point.z);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), pointX);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), pointY);
+    __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), pointZ);
+    __m256 sum = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    _mm256_storeu_ps(out + i, _mm256_add_ps(sum, _mm256_mul_ps(dz, dz)));
+  }
+  distanceSquaredScalar(x + i, y + i, z + i, point, out + i, count - i);
+}
+
+inline bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0) {
+    return false;
+  }
+  // The OS has to save the YMM registers on context switches.
+  if ((_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+inline StreamKernels selectStreamKernels() {
+#if GW_SIMD_X86
+  if (cpuSupportsAVX2()) {
+    return {integrateAVX2, inBoundsAVX2, distanceSquaredAVX2, "avx2"};
+  }
+#endif
+#if GW_SIMD_SSE
+  return {integrateSSE, inBoundsSSE, distanceSquaredSSE, "sse"};
+#endif
+  return {integrateScalar, inBoundsScalar, distanceSquaredScalar, "scalar"};
+}
+
+inline const StreamKernels &streamKernels() {
+  static const StreamKernels kernels = selectStreamKernels();
+  return kernels;
+}
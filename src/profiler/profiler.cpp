@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||           \
+    defined(_M_IX86)
+#define GW_PROFILE_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define GW_PROFILE_TSC 0
+#endif
+
+// Scopes are recorded in builds without NDEBUG; define GW_PROFILE to 0 or 1
+// to override. When off, GW_PROFILE_SCOPE expands to nothing and the
+// profiler only ever sees empty rings.
+#ifndef GW_PROFILE
+#ifdef NDEBUG
+#define GW_PROFILE 0
+#else
+#define GW_PROFILE 1
+#endif
+#endif
+
+// Raw timestamp: the TSC on x86, steady_clock elsewhere. Profiler converts
+// ticks to nanoseconds when it reads them.
+inline uint64_t profileTicks() {
+#if GW_PROFILE_TSC
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// One finished scope. name must outlive the profiler: a string literal or a
+// result of Profiler::intern.
+struct ProfileEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+const uint32_t PROFILE_RING_CAPACITY = 1 << 16;
+
+// Written only by its own thread. head counts every event ever pushed, so a
+// reader can tell which of the slots it copied were overwritten meanwhile.
+struct ProfileRing {
+  std::atomic<uint64_t> head{0};
+  std::string threadName;
+  uint32_t threadId = 0;
+
+  // Read position of Profiler::endFrame.
+  uint64_t collected = 0;
+
+  std::unique_ptr<ProfileEvent[]> events{
+      new ProfileEvent[PROFILE_RING_CAPACITY]};
+
+  void push(const char *name, uint64_t start, uint64_t end) {
+    uint64_t index = head.load(std::memory_order_relaxed);
+    events[index & (PROFILE_RING_CAPACITY - 1)] = {name, start, end};
+    head.store(index + 1, std::memory_order_release);
+  }
+
+  // After copying events out, the oldest index the owning thread can't have
+  // overwritten or be overwriting during the copy. Copies from before it
+  // may be torn.
+  uint64_t firstIntact() const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = head.load(std::memory_order_relaxed);
+    return after >= PROFILE_RING_CAPACITY ? after - PROFILE_RING_CAPACITY + 1
+                                          : 0;
+  }
+};
+
+const int PROFILE_HISTORY_LENGTH = 240;
+
+// Per-frame totals of one scope name over the last PROFILE_HISTORY_LENGTH
+// frames, oldest first starting at Profiler::historyStart().
+struct ScopeHistory {
+  std::array<float, PROFILE_HISTORY_LENGTH> milliseconds{};
+  std::array<int, PROFILE_HISTORY_LENGTH> calls{};
+};
+
+// Collects scopes from every thread. Each thread gets a ring on its first
+// scope; rings are never freed, so events of exited threads stay
+// exportable.
+struct Profiler {
+  Profiler()
+      : startTicks(profileTicks()), startTime(std::chrono::steady_clock::now()) {
+  }
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  ProfileRing &localRing() {
+    thread_local ProfileRing *ring = nullptr;
+    thread_local Profiler *owner = nullptr;
+    if (owner != this) {
+      ring = registerThread();
+      owner = this;
+    }
+    return *ring;
+  }
+
+  // Shown as the thread's row name in exported traces.
+  void nameThread(std::string name) {
+    ProfileRing &ring = localRing();
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.threadName = std::move(name);
+  }
+
+  // Returns a pointer that stays valid for the profiler's lifetime, for
+  // scope names built at runtime.
+  const char *intern(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.insert(name).first->c_str();
+  }
+
+  // Folds the scopes finished since the last call into the per-scope
+  // histories as one frame. Call once per frame from one thread.
+  void endFrame() {
+    std::unordered_map<const char *, std::pair<uint64_t, int>> totals;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = std::max(ring->collected,
+                                  head > PROFILE_RING_CAPACITY
+                                      ? head - PROFILE_RING_CAPACITY
+                                      : 0);
+        frameEvents.clear();
+        for (uint64_t i = first; i < head; i++) {
+          frameEvents.push_back(ring->events[i & (PROFILE_RING_CAPACITY - 1)]);
+        }
+        // Like writeChromeTrace, drop the slots the owning thread lapped
+        // while they were copied.
+        uint64_t intact = std::max(first, ring->firstIntact());
+        for (uint64_t i = intact; i < head; i++) {
+          const ProfileEvent &event = frameEvents[i - first];
+          auto &total = totals[event.name];
+          total.first += event.end - event.start;
+          total.second++;
+        }
+        ring->collected = head;
+      }
+    }
+
+    double nsPerTick = nanosecondsPerTick();
+    int slot = static_cast<int>(frameCount % PROFILE_HISTORY_LENGTH);
+    for (auto &entry : totals) {
+      if (histories.find(entry.first) == histories.end()) {
+        order.push_back(entry.first);
+      }
+    }
+    for (const char *name : order) {
+      ScopeHistory &history = histories[name];
+      auto found = totals.find(name);
+      bool ran = found != totals.end();
+      history.milliseconds[slot] =
+          ran ? static_cast<float>(found->second.first * nsPerTick * 1e-6)
+              : 0.0f;
+      history.calls[slot] = ran ? found->second.second : 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (frameCount > 0) {
+      frameMilliseconds[slot] = static_cast<float>(
+          std::chrono::duration<double, std::milli>(now - lastFrameEnd)
+              .count());
+    }
+    lastFrameEnd = now;
+    frameCount++;
+  }
+
+  uint64_t frames() const { return frameCount; }
+
+  // Slot of the oldest frame in every history array.
+  int historyStart() const {
+    return static_cast<int>(frameCount % PROFILE_HISTORY_LENGTH);
+  }
+
+  // Wall time between consecutive endFrame calls.
+  const std::array<float, PROFILE_HISTORY_LENGTH> &frameTimes() const {
+    return frameMilliseconds;
+  }
+
+  // Scope names in order of first appearance, with their histories.
+  template <typename Func> void eachScope(Func func) const {
+    for (const char *name : order) {
+      func(name, histories.at(name));
+    }
+  }
+
+  // Writes what every ring still holds as Chrome trace event JSON, which
+  // chrome://tracing and ui.perfetto.dev open. Returns false if the file
+  // can't be written.
+  bool writeChromeTrace(const std::string &path) {
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+      return false;
+    }
+
+    double nsPerTick = nanosecondsPerTick();
+    std::vector<ProfileEvent> events;
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &ring : rings) {
+      std::fprintf(file,
+                   "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                   "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                   first ? "" : ",\n", ring->threadId,
+                   escaped(ring->threadName.c_str()).c_str());
+      first = false;
+
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t begin =
+          head > PROFILE_RING_CAPACITY ? head - PROFILE_RING_CAPACITY : 0;
+      events.clear();
+      for (uint64_t i = begin; i < head; i++) {
+        events.push_back(ring->events[i & (PROFILE_RING_CAPACITY - 1)]);
+      }
+      // The owning thread keeps writing while we copy; drop the slots it
+      // may have lapped.
+      uint64_t intact = std::min(std::max(begin, ring->firstIntact()), head);
+      events.erase(events.begin(), events.begin() + (intact - begin));
+
+      for (const ProfileEvent &event : events) {
+        double start = ticksToMicroseconds(event.start, nsPerTick);
+        double duration = (event.end - event.start) * nsPerTick * 1e-3;
+        std::fprintf(file,
+                     ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+                     "\"ts\":%.3f,\"dur\":%.3f}",
+                     escaped(event.name).c_str(), ring->threadId, start,
+                     duration);
+      }
+    }
+
+    std::fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    return std::fclose(file) == 0;
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ProfileRing>> rings;
+  std::vector<ProfileEvent> frameEvents;
+  std::unordered_set<std::string> names;
+
+  std::unordered_map<const char *, ScopeHistory> histories;
+  std::vector<const char *> order;
+  std::array<float, PROFILE_HISTORY_LENGTH> frameMilliseconds{};
+  std::chrono::steady_clock::time_point lastFrameEnd;
+  uint64_t frameCount = 0;
+
+  uint64_t startTicks;
+  std::chrono::steady_clock::time_point startTime;
+
+  ProfileRing *registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    rings.push_back(std::make_unique<ProfileRing>());
+    ProfileRing *ring = rings.back().get();
+    ring->threadId = static_cast<uint32_t>(rings.size() - 1);
+    ring->threadName = "thread " + std::to_string(ring->threadId);
+    return ring;
+  }
+
+  // The TSC rate is measured against steady_clock over the profiler's
+  // lifetime so far, which gets more precise the longer it runs.
+  double nanosecondsPerTick() const {
+#if GW_PROFILE_TSC
+    uint64_t ticks = profileTicks() - startTicks;
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - startTime)
+                    .count();
+    return ticks == 0 ? 1.0 : ns / ticks;
+#else
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::duration(1))
+        .count();
+#endif
+  }
+
+  static std::string escaped(const char *text) {
+    std::string result;
+    for (; *text != '\0'; text++) {
+      if (*text == '"' || *text == '\\') {
+        result += '\\';
+      }
+      result += *text;
+    }
+    return result;
+  }
+
+  double ticksToMicroseconds(uint64_t ticks, double nsPerTick) const {
+    return static_cast<double>(static_cast<int64_t>(ticks - startTicks)) *
+           nsPerTick * 1e-3;
+  }
+};
+
+// Never destroyed, so scopes closing during static destruction still have
+// somewhere to go.
+inline Profiler &profiler() {
+  static Profiler *instance = new Profiler();
+  return *instance;
+}
+
+// Records the time between construction and destruction into the calling
+// thread's ring of the global profiler.
+struct ProfileScope {
+  explicit ProfileScope(const char *name)
+      : ring(&profiler().localRing()), name(name), start(profileTicks()) {}
+
+  ~ProfileScope() { ring->push(name, start, profileTicks()); }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  ProfileRing *ring;
+  const char *name;
+  uint64_t start;
+};
+
+#define GW_PROFILE_JOIN_(a, b) a##b
+#define GW_PROFILE_JOIN(a, b) GW_PROFILE_JOIN_(a, b)
+
+#if GW_PROFILE
+#define GW_PROFILE_SCOPE(name)                                                 \
+  ProfileScope GW_PROFILE_JOIN(profileScope, __LINE__)(name)
+#else
+#define GW_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+#define GW_PROFILE_FUNCTION() GW_PROFILE_SCOPE(__func__)
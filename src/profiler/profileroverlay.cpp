@@ -0,0 +1,46 @@
+#pragma once
+
+#include "imgui.h"
+#include "profiler.cpp"
+
+#include <algorithm>
+
+// Draws the profiler's rolling frame time and one histogram per scope name
+// into an ImGui window. Call between ImGui::NewFrame and ImGui::Render. Kept
+// out of the profiler library so that builds without ImGui can profile.
+inline void drawProfilerOverlay(Profiler &profiler) {
+  ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler")) {
+    ImGui::End();
+    return;
+  }
+
+  int start = profiler.historyStart();
+  int newest = (start + PROFILE_HISTORY_LENGTH - 1) % PROFILE_HISTORY_LENGTH;
+
+  const auto &frames = profiler.frameTimes();
+  float worstFrame = *std::max_element(frames.begin(), frames.end());
+  ImGui::Text("frame %.2f ms (worst %.2f ms)", frames[newest], worstFrame);
+  ImGui::PlotLines("##frame", frames.data(), PROFILE_HISTORY_LENGTH, start,
+                   nullptr, 0.0f, std::max(worstFrame, 1.0f),
+                   ImVec2(-1, 48));
+
+  profiler.eachScope([&](const char *name, const ScopeHistory &history) {
+    float total = 0;
+    float worst = 0;
+    for (float milliseconds : history.milliseconds) {
+      total += milliseconds;
+      worst = std::max(worst, milliseconds);
+    }
+    ImGui::PushID(name);
+    ImGui::Text("%s  %.3f ms  avg %.3f  max %.3f  x%d", name,
+                history.milliseconds[newest],
+                total / PROFILE_HISTORY_LENGTH, worst, history.calls[newest]);
+    ImGui::PlotHistogram("##scope", history.milliseconds.data(),
+                         PROFILE_HISTORY_LENGTH, start, nullptr, 0.0f,
+                         std::max(worst, 0.001f), ImVec2(-1, 32));
+    ImGui::PopID();
+  });
+
+  ImGui::End();
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "suballocator.cpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+enum class GpuResourceKind {
+  // Buffers and linear images.
+  Linear,
+  // Optimal-tiling images. Kept in blocks of their own so that
+  // bufferImageGranularity never applies between neighbours.
+  Optimal,
+};
+
+struct GpuAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  // Start of the allocation in the persistently mapped block, or nullptr
+  // for memory that isn't host visible.
+  void *mapped = nullptr;
+
+  int block = -1;
+  SubAllocation range;
+};
+
+// Carves allocations out of large VkDeviceMemory blocks, one list of
+// blocks per memory type and resource kind, each managed by a
+// TlsfAllocator. Host-visible blocks are mapped once for their lifetime.
+// Requests bigger than half a block get a dedicated block.
+struct GpuAllocator {
+  static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  void init(VkPhysicalDevice physicalDevice, VkDevice device,
+            VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE) {
+    this->device = device;
+    this->blockSize = blockSize;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  }
+
+  uint32_t findMemoryType(uint32_t typeFilter,
+                          VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+      if ((typeFilter & (1u << i)) &&
+          (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+              properties) {
+        return i;
+      }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+
+  GpuAllocation allocate(const VkMemoryRequirements &requirements,
+                         VkMemoryPropertyFlags properties,
+                         GpuResourceKind kind = GpuResourceKind::Linear) {
+    uint32_t memoryType =
+        findMemoryType(requirements.memoryTypeBits, properties);
+
+    if (requirements.size <= blockSize / 2) {
+      for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+        if (!blocks[i]) {
+          continue;
+        }
+        Block &block = *blocks[i];
+        if (block.memoryType != memoryType || block.kind != kind ||
+            block.dedicated) {
+          continue;
+        }
+        SubAllocation range =
+            block.ranges.allocate(requirements.size, requirements.alignment);
+        if (range.valid()) {
+          return makeAllocation(i, range);
+        }
+      }
+    }
+
+    bool dedicated = requirements.size > blockSize / 2;
+    int index = createBlock(memoryType, kind,
+                            dedicated ? requirements.size : blockSize,
+                            dedicated);
+    // Offset 0 of a fresh block satisfies any alignment.
+    SubAllocation range = blocks[index]->ranges.allocate(requirements.size);
+    if (!range.valid()) {
+      releaseBlock(index);
+    }
+    return makeAllocation(index, range);
+  }
+
+  // Empty blocks are kept for reuse; trim() returns them to the driver.
+  void free(const GpuAllocation &allocation) {
+    if (allocation.block == -1) {
+      return;
+    }
+    Block &block = *blocks[allocation.block];
+    block.ranges.free(allocation.range);
+    if (block.dedicated) {
+      releaseBlock(allocation.block);
+    }
+  }
+
+  void trim() {
+    for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+      if (blocks[i] && blocks[i]->ranges.empty()) {
+        releaseBlock(i);
+      }
+    }
+  }
+
+  // Creates a buffer and binds it to memory from this allocator.
+  VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                        VkMemoryPropertyFlags properties,
+                        GpuAllocation &allocation) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    allocation = allocate(requirements, properties, GpuResourceKind::Linear);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+    return buffer;
+  }
+
+  void destroyBuffer(VkBuffer buffer, const GpuAllocation &allocation) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    free(allocation);
+  }
+
+  // Frees every block. Resources still bound to them must be gone.
+  void destroy() {
+    for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+      if (blocks[i]) {
+        releaseBlock(i);
+      }
+    }
+    blocks.clear();
+  }
+
+  // Live VkDeviceMemory objects, i.e. vkAllocateMemory calls not yet
+  // undone.
+  int blockCount() const { return liveBlocks; }
+  VkDeviceSize reservedBytes() const { return reserved; }
+
+private:
+  struct Block {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint32_t memoryType = 0;
+    GpuResourceKind kind = GpuResourceKind::Linear;
+    bool dedicated = false;
+    void *mapped = nullptr;
+    TlsfAllocator ranges;
+  };
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+  // Released blocks leave a null entry so block indices stay valid.
+  std::vector<std::unique_ptr<Block>> blocks;
+  int liveBlocks = 0;
+  VkDeviceSize reserved = 0;
+
+  int createBlock(uint32_t memoryType, GpuResourceKind kind, VkDeviceSize size,
+                  bool dedicated) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    auto block = std::make_unique<Block>();
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate device memory block!");
+    }
+    block->memoryType = memoryType;
+    block->kind = kind;
+    block->dedicated = dedicated;
+    block->ranges.reset(size);
+
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags &
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+      vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+    }
+
+    liveBlocks++;
+    reserved += size;
+
+    for (int i = 0; i < static_cast<int>(blocks.size()); i++) {
+      if (!blocks[i]) {
+        blocks[i] = std::move(block);
+        return i;
+      }
+    }
+    blocks.push_back(std::move(block));
+    return static_cast<int>(blocks.size()) - 1;
+  }
+
+  void releaseBlock(int index) {
+    Block &block = *blocks[index];
+    if (block.mapped != nullptr) {
+      vkUnmapMemory(device, block.memory);
+    }
+    vkFreeMemory(device, block.memory, nullptr);
+    liveBlocks--;
+    reserved -= block.ranges.size();
+    blocks[index].reset();
+  }
+
+  GpuAllocation makeAllocation(int index, const SubAllocation &range) {
+    if (!range.valid()) {
+      throw std::runtime_error("device memory block can't fit allocation!");
+    }
+    Block &block = *blocks[index];
+    GpuAllocation allocation;
+    allocation.memory = block.memory;
+    allocation.offset = range.offset;
+    allocation.size = range.size;
+    allocation.mapped =
+        block.mapped != nullptr
+            ? static_cast<char *>(block.mapped) + range.offset
+            : nullptr;
+    allocation.block = index;
+    allocation.range = range;
+    return allocation;
+  }
+};
+
+// Linear strategy for transient data: one buffer from a GpuAllocator,
+// bump-allocated during a frame and reset once the GPU is done with it.
+struct GpuArena {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  GpuAllocation allocation;
+
+  void init(GpuAllocator &allocator, VkDeviceSize size,
+            VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    buffer = allocator.createBuffer(size, usage, properties, allocation);
+    ranges.reset(size);
+  }
+
+  // Returns an invalid range when the arena is full.
+  SubAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16) {
+    return ranges.allocate(size, alignment);
+  }
+
+  // Host pointer of a range, for host-visible arenas.
+  void *pointer(const SubAllocation &range) const {
+    return static_cast<char *>(allocation.mapped) + range.offset;
+  }
+
+  void reset() { ranges.reset(); }
+
+  void destroy(GpuAllocator &allocator) {
+    if (buffer != VK_NULL_HANDLE) {
+      allocator.destroyBuffer(buffer, allocation);
+      buffer = VK_NULL_HANDLE;
+    }
+  }
+
+private:
+  LinearAllocator ranges;
+};
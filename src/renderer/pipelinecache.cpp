@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// A VkPipelineCache backed by a file. Data whose header was written by a
+// different vendor, device or driver build is ignored rather than handed
+// to the driver, so a GPU or driver change only costs one cold start.
+// Pipeline creation may use handle() from several threads at once.
+struct PipelineCache {
+  // Creates the cache, seeded from path when the file holds data for this
+  // device. Returns whether it was.
+  bool load(VkPhysicalDevice physicalDevice, VkDevice device,
+            const std::string &path) {
+    this->device = device;
+    this->path = path;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    std::vector<char> data;
+    std::ifstream file(path, std::ios::binary);
+    if (file.is_open()) {
+      data.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    }
+    warm = matchesDevice(data, properties);
+    if (!warm) {
+      data.clear();
+    }
+    loadedBytes = data.size();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+        VK_SUCCESS) {
+      // Stale data the header check missed; start over empty.
+      cacheInfo.initialDataSize = 0;
+      cacheInfo.pInitialData = nullptr;
+      warm = false;
+      loadedBytes = 0;
+      if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+      }
+    }
+    return warm;
+  }
+
+  // Writes the cache next to path and renames it into place, so a crash
+  // mid-write never leaves a truncated file. Returns false on failure.
+  bool save() {
+    if (cache == VK_NULL_HANDLE) {
+      return false;
+    }
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+      return false;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) !=
+        VK_SUCCESS) {
+      return false;
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(data.data(), static_cast<std::streamsize>(size));
+      if (!file) {
+        return false;
+      }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+  }
+
+  void destroy() {
+    if (cache != VK_NULL_HANDLE) {
+      vkDestroyPipelineCache(device, cache, nullptr);
+      cache = VK_NULL_HANDLE;
+    }
+  }
+
+  VkPipelineCache handle() const { return cache; }
+
+  // Whether load() found usable data, i.e. this is a warm start.
+  bool isWarm() const { return warm; }
+  size_t bytesLoaded() const { return loadedBytes; }
+
+  // Checks the VkPipelineCacheHeaderVersionOne every cache blob starts
+  // with against the device that is about to use it.
+  static bool matchesDevice(const std::vector<char> &data,
+                            const VkPhysicalDeviceProperties &properties) {
+    const size_t headerSize = 16 + VK_UUID_SIZE;
+    if (data.size() < headerSize) {
+      return false;
+    }
+    uint32_t fields[4];
+    std::memcpy(fields, data.data(), sizeof(fields));
+    return fields[0] >= headerSize && fields[0] <= data.size() &&
+           fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           fields[2] == properties.vendorID &&
+           fields[3] == properties.deviceID &&
+           std::memcmp(data.data() + 16, properties.pipelineCacheUUID,
+                       VK_UUID_SIZE) == 0;
+  }
+
+private:
+  VkDevice device = VK_NULL_HANDLE;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  std::string path;
+  bool warm = false;
+  size_t loadedBytes = 0;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "gpuallocator.cpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Streams data into device-local buffers through one persistently mapped,
+// host-coherent buffer used as a ring. upload() copies into the ring right
+// away and queues the region; record() turns everything queued into one
+// vkCmdCopyBuffer per destination followed by a single barrier. Ring space
+// comes back when the frame slot that recorded it retires.
+struct StagingRing {
+  void init(GpuAllocator &allocator, VkDeviceSize capacity,
+            uint32_t frameSlots) {
+    this->capacity = capacity;
+    buffer = allocator.createBuffer(
+        capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        allocation);
+    slotHeads.assign(frameSlots, 0);
+  }
+
+  // Returns false if the ring has no room until an earlier frame retires.
+  bool upload(VkBuffer destination, VkDeviceSize destinationOffset,
+              const void *data, VkDeviceSize size) {
+    if (size == 0) {
+      return true;
+    }
+    VkDeviceSize start = alignOffset(head, COPY_ALIGNMENT);
+    if (start % capacity + size > capacity) {
+      // Never split a region across the wrap; skip to the start instead.
+      start = alignOffset(start, capacity);
+    }
+    if (start + size - tail > capacity) {
+      return false;
+    }
+
+    std::memcpy(static_cast<char *>(allocation.mapped) + start % capacity,
+                data, size);
+    VkBufferCopy region{};
+    region.srcOffset = start % capacity;
+    region.dstOffset = destinationOffset;
+    region.size = size;
+    pending.push_back({destination, region});
+    head = start + size;
+    bytesUploaded += size;
+    return true;
+  }
+
+  // Records the queued copies into commandBuffer, outside a render pass.
+  // The data stays in the ring until retire(frameSlot).
+  void record(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    slotHeads[frameSlot] = head;
+    if (pending.empty()) {
+      return;
+    }
+
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const Pending &a, const Pending &b) {
+                       return a.destination < b.destination;
+                     });
+    std::vector<VkBufferCopy> regions;
+    for (std::size_t i = 0; i < pending.size();) {
+      std::size_t end = i;
+      regions.clear();
+      while (end < pending.size() &&
+             pending[end].destination == pending[i].destination) {
+        regions.push_back(pending[end].region);
+        end++;
+      }
+      vkCmdCopyBuffer(commandBuffer, buffer, pending[i].destination,
+                      static_cast<uint32_t>(regions.size()), regions.data());
+      copyCommands++;
+      i = end;
+    }
+    pending.clear();
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                            VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT |
+                            VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+  }
+
+  // frameSlot's fence has signaled: its copies are done.
+  void retire(uint32_t frameSlot) {
+    tail = std::max(tail, slotHeads[frameSlot]);
+  }
+
+  void destroy(GpuAllocator &allocator) {
+    if (buffer != VK_NULL_HANDLE) {
+      allocator.destroyBuffer(buffer, allocation);
+      buffer = VK_NULL_HANDLE;
+    }
+  }
+
+  VkDeviceSize uploaded() const { return bytesUploaded; }
+  uint64_t copies() const { return copyCommands; }
+
+private:
+  static const VkDeviceSize COPY_ALIGNMENT = 16;
+
+  struct Pending {
+    VkBuffer destination;
+    VkBufferCopy region;
+  };
+
+  VkBuffer buffer = VK_NULL_HANDLE;
+  GpuAllocation allocation;
+  VkDeviceSize capacity = 0;
+
+  // Positions grow without wrapping; the ring offset is position % capacity.
+  VkDeviceSize head = 0;
+  VkDeviceSize tail = 0;
+  std::vector<VkDeviceSize> slotHeads;
+
+  std::vector<Pending> pending;
+  VkDeviceSize bytesUploaded = 0;
+  uint64_t copyCommands = 0;
+};
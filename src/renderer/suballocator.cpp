@@ -0,0 +1,332 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Offset allocators that carve ranges out of one fixed-size region. They
+// only do bookkeeping, so the same code manages device memory blocks,
+// mapped buffers or anything else addressed by offset.
+
+struct SubAllocation {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  // Bookkeeping handle for free(); -1 when the allocation failed.
+  int node = -1;
+
+  bool valid() const { return node != -1; }
+};
+
+inline uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+  return alignment > 1 ? (offset + alignment - 1) / alignment * alignment
+                       : offset;
+}
+
+// Two-level segregated fit: free ranges are binned by the power of two of
+// their size and then by SL_COUNT linear steps within it, with a bitmap per
+// level, so allocate and free are O(1) and the range returned is a good fit.
+// Freed ranges merge with free neighbours immediately.
+struct TlsfAllocator {
+  explicit TlsfAllocator(uint64_t capacity = 0) { reset(capacity); }
+
+  void reset(uint64_t newCapacity) {
+    capacity = newCapacity;
+    blocks.clear();
+    unusedNodes.clear();
+    flBitmap = 0;
+    for (int fl = 0; fl < FL_COUNT; fl++) {
+      slBitmap[fl] = 0;
+      for (int sl = 0; sl < SL_COUNT; sl++) {
+        heads[fl][sl] = -1;
+      }
+    }
+    available = 0;
+    if (capacity > 0) {
+      int node = newNode();
+      blocks[node].offset = 0;
+      blocks[node].size = capacity;
+      insertFree(node);
+    }
+  }
+
+  // Returns an invalid allocation if no free range can hold size bytes at
+  // the given power-of-two alignment.
+  SubAllocation allocate(uint64_t size, uint64_t alignment = 1) {
+    if (size == 0) {
+      size = 1;
+    }
+    if (size > capacity) {
+      return {};
+    }
+
+    int node = findFree(size, alignment);
+    if (node == -1) {
+      return {};
+    }
+    removeFree(node);
+
+    uint64_t aligned = alignOffset(blocks[node].offset, alignment);
+    uint64_t padding = aligned - blocks[node].offset;
+    if (padding > 0) {
+      // The physical predecessor is in use (free neighbours are always
+      // merged), so the padding becomes a free range of its own.
+      int front = newNode();
+      Block &block = blocks[node];
+      blocks[front].offset = block.offset;
+      blocks[front].size = padding;
+      blocks[front].prevPhysical = block.prevPhysical;
+      blocks[front].nextPhysical = node;
+      if (block.prevPhysical != -1) {
+        blocks[block.prevPhysical].nextPhysical = front;
+      }
+      block.prevPhysical = front;
+      block.offset = aligned;
+      block.size -= padding;
+      insertFree(front);
+    }
+
+    if (blocks[node].size - size >= MIN_SPLIT) {
+      int back = newNode();
+      Block &block = blocks[node];
+      blocks[back].offset = block.offset + size;
+      blocks[back].size = block.size - size;
+      blocks[back].prevPhysical = node;
+      blocks[back].nextPhysical = block.nextPhysical;
+      if (block.nextPhysical != -1) {
+        blocks[block.nextPhysical].prevPhysical = back;
+      }
+      block.nextPhysical = back;
+      block.size = size;
+      insertFree(back);
+    }
+
+    return {blocks[node].offset, blocks[node].size, node};
+  }
+
+  void free(const SubAllocation &allocation) {
+    int node = allocation.node;
+    if (node == -1) {
+      return;
+    }
+
+    int next = blocks[node].nextPhysical;
+    if (next != -1 && blocks[next].free) {
+      removeFree(next);
+      absorbNext(node);
+    }
+    int previous = blocks[node].prevPhysical;
+    if (previous != -1 && blocks[previous].free) {
+      removeFree(previous);
+      absorbNext(previous);
+      node = previous;
+    }
+    insertFree(node);
+  }
+
+  uint64_t size() const { return capacity; }
+  uint64_t freeBytes() const { return available; }
+  bool empty() const { return available == capacity; }
+
+private:
+  static const int SL_BITS = 4;
+  static const int SL_COUNT = 1 << SL_BITS;
+  static const int FL_COUNT = 64 - SL_BITS + 1;
+  static const uint64_t MIN_SPLIT = 16;
+
+  struct Block {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    int prevPhysical = -1;
+    int nextPhysical = -1;
+    int prevFree = -1;
+    int nextFree = -1;
+    bool free = false;
+  };
+
+  uint64_t capacity = 0;
+  uint64_t available = 0;
+  std::vector<Block> blocks;
+  std::vector<int> unusedNodes;
+
+  uint64_t flBitmap = 0;
+  uint32_t slBitmap[FL_COUNT];
+  int heads[FL_COUNT][SL_COUNT];
+
+  static int highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+
+  static int lowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+  }
+
+  static void mapping(uint64_t size, int &fl, int &sl) {
+    if (size < SL_COUNT) {
+      fl = 0;
+      sl = static_cast<int>(size);
+      return;
+    }
+    int msb = highestBit(size);
+    fl = msb - SL_BITS + 1;
+    sl = static_cast<int>(size >> (msb - SL_BITS)) ^ SL_COUNT;
+  }
+
+  // Any range in the list found for the padded request is long enough,
+  // because the request is rounded up to the next list boundary first.
+  // Ranges that fit without the rounding or the worst-case alignment
+  // padding, such as a whole fresh allocator handed out at once, sit in the
+  // lists between size's and that one, so those are searched as a fallback.
+  int findFree(uint64_t size, uint64_t alignment) {
+    uint64_t request = size + (alignment > 1 ? alignment - 1 : 0);
+    if (request >= SL_COUNT) {
+      request += (uint64_t(1) << (highestBit(request) - SL_BITS)) - 1;
+    }
+    int fl;
+    int sl;
+    mapping(request, fl, sl);
+    int lastFl = fl;
+    int lastSl = sl;
+    if (fl < FL_COUNT) {
+      uint32_t slMask = slBitmap[fl] & (~0u << sl);
+      uint64_t flMask =
+          fl + 1 < 64 ? flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+      if (slMask != 0) {
+        return heads[fl][lowestBit(slMask)];
+      }
+      if (flMask != 0) {
+        fl = lowestBit(flMask);
+        return heads[fl][lowestBit(slBitmap[fl])];
+      }
+    } else {
+      lastFl = FL_COUNT - 1;
+      lastSl = SL_COUNT - 1;
+    }
+
+    mapping(size, fl, sl);
+    for (; fl <= lastFl; fl++, sl = 0) {
+      uint32_t slMask = slBitmap[fl] & (~0u << sl);
+      if (fl == lastFl) {
+        slMask &= (2u << lastSl) - 1;
+      }
+      for (; slMask != 0; slMask &= slMask - 1) {
+        for (int node = heads[fl][lowestBit(slMask)]; node != -1;
+             node = blocks[node].nextFree) {
+          const Block &block = blocks[node];
+          if (alignOffset(block.offset, alignment) + size <=
+              block.offset + block.size) {
+            return node;
+          }
+        }
+      }
+    }
+    return -1;
+  }
+
+  void insertFree(int node) {
+    Block &block = blocks[node];
+    int fl;
+    int sl;
+    mapping(block.size, fl, sl);
+    block.free = true;
+    block.prevFree = -1;
+    block.nextFree = heads[fl][sl];
+    if (block.nextFree != -1) {
+      blocks[block.nextFree].prevFree = node;
+    }
+    heads[fl][sl] = node;
+    slBitmap[fl] |= 1u << sl;
+    flBitmap |= uint64_t(1) << fl;
+    available += block.size;
+  }
+
+  void removeFree(int node) {
+    Block &block = blocks[node];
+    int fl;
+    int sl;
+    mapping(block.size, fl, sl);
+    if (block.prevFree != -1) {
+      blocks[block.prevFree].nextFree = block.nextFree;
+    } else {
+      heads[fl][sl] = block.nextFree;
+      if (block.nextFree == -1) {
+        slBitmap[fl] &= ~(1u << sl);
+        if (slBitmap[fl] == 0) {
+          flBitmap &= ~(uint64_t(1) << fl);
+        }
+      }
+    }
+    if (block.nextFree != -1) {
+      blocks[block.nextFree].prevFree = block.prevFree;
+    }
+    block.free = false;
+    available -= block.size;
+  }
+
+  // Merges node's physical successor into node and recycles its entry.
+  void absorbNext(int node) {
+    int next = blocks[node].nextPhysical;
+    blocks[node].size += blocks[next].size;
+    blocks[node].nextPhysical = blocks[next].nextPhysical;
+    if (blocks[next].nextPhysical != -1) {
+      blocks[blocks[next].nextPhysical].prevPhysical = node;
+    }
+    unusedNodes.push_back(next);
+  }
+
+  int newNode() {
+    if (!unusedNodes.empty()) {
+      int node = unusedNodes.back();
+      unusedNodes.pop_back();
+      blocks[node] = Block{};
+      return node;
+    }
+    blocks.emplace_back();
+    return static_cast<int>(blocks.size()) - 1;
+  }
+};
+
+// Bump allocator for memory that is released all at once, such as a
+// frame's transient data. free is a no-op; reset reclaims everything.
+struct LinearAllocator {
+  explicit LinearAllocator(uint64_t capacity = 0) : capacity(capacity) {}
+
+  SubAllocation allocate(uint64_t size, uint64_t alignment = 1) {
+    uint64_t offset = alignOffset(head, alignment);
+    if (offset + size > capacity) {
+      return {};
+    }
+    head = offset + size;
+    return {offset, size, 0};
+  }
+
+  void free(const SubAllocation &) {}
+
+  void reset() { head = 0; }
+  void reset(uint64_t newCapacity) {
+    capacity = newCapacity;
+    head = 0;
+  }
+
+  uint64_t size() const { return capacity; }
+  uint64_t freeBytes() const { return capacity - head; }
+  bool empty() const { return head == 0; }
+
+private:
+  uint64_t capacity;
+  uint64_t head = 0;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Like assert, but also checked in Release builds, which is what ctest
+// usually runs.
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      std::exit(1);                                                            \
+    }                                                                          \
+  } while (0)
@@ -0,0 +1,38 @@
+// Storages of empty component types keep no component array at all; make
+// sure every storage operation still compiles and behaves for them.
+#include "check.hpp"
+#include "registry.cpp"
+
+#include <vector>
+
+struct Dead {};
+struct Health {
+  int value;
+};
+
+int main() {
+  Registry registry;
+  std::vector<Entity> entities = registry.create(3);
+  for (Entity entity : entities) {
+    registry.addComponent(entity, Health{10});
+    registry.addComponent(entity, Dead{});
+  }
+  registry.removeComponent<Dead>(entities[1]);
+
+  int dead = 0;
+  registry.view<Health, Dead>().each([&](Entity entity, Health &, Dead &) {
+    CHECK(entity != entities[1]);
+    dead++;
+  });
+  CHECK(dead == 2);
+
+  int alive = 0;
+  registry.view<Health>(exclude<Dead>).each([&](Health &) { alive++; });
+  CHECK(alive == 1);
+
+  CHECK(registry.storage<Dead>().size() == 2);
+  // Only the sparse set allocates.
+  CHECK(registry.memoryUsage<Dead>() ==
+        registry.storage<Dead>().sparseSet.memoryUsage());
+  return 0;
+}
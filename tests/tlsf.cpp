@@ -0,0 +1,54 @@
+// TlsfAllocator edge cases: a fresh allocator must hand out its whole
+// capacity in one piece, which is how GpuAllocator fills a dedicated block,
+// and must be able to again once everything was freed.
+#include "check.hpp"
+#include "suballocator.cpp"
+
+#include <vector>
+
+void checkWholeCapacity(uint64_t capacity) {
+  TlsfAllocator allocator(capacity);
+  SubAllocation all = allocator.allocate(capacity);
+  CHECK(all.valid());
+  CHECK(all.offset == 0 && all.size == capacity);
+  CHECK(allocator.freeBytes() == 0);
+  CHECK(!allocator.allocate(1).valid());
+  allocator.free(all);
+  CHECK(allocator.empty());
+
+  // Offset 0 satisfies any alignment, so this fits exactly too.
+  SubAllocation aligned = allocator.allocate(capacity, 256);
+  CHECK(aligned.valid() && aligned.offset == 0);
+  allocator.free(aligned);
+
+  // Fragment it, free everything, and the whole range comes back.
+  std::vector<SubAllocation> pieces;
+  for (SubAllocation piece = allocator.allocate(capacity / 7 + 1, 16);
+       piece.valid(); piece = allocator.allocate(capacity / 7 + 1, 16)) {
+    pieces.push_back(piece);
+  }
+  CHECK(!pieces.empty());
+  for (const SubAllocation &piece : pieces) {
+    allocator.free(piece);
+  }
+  CHECK(allocator.empty());
+  CHECK(allocator.allocate(capacity).valid());
+}
+
+int main() {
+  const uint64_t sizes[] = {1,           15,          16,
+                            1000,        4096,        12345678,
+                            40000000,    (33ull << 20) + 4096,
+                            64ull << 20};
+  for (uint64_t size : sizes) {
+    checkWholeCapacity(size);
+  }
+
+  // GpuAllocator's dedicated path: one block sized to the request.
+  const uint64_t dedicated = (48ull << 20) + 12345;
+  TlsfAllocator block(dedicated);
+  SubAllocation range = block.allocate(dedicated);
+  CHECK(range.valid() && range.size == dedicated);
+  CHECK(!TlsfAllocator(dedicated).allocate(dedicated + 1).valid());
+  return 0;
+}